@@ -74,10 +74,28 @@ namespace ble {
             return characteristic.WriteValueAsync(to_buffer(_data), GattWriteOption::WriteWithoutResponse);
         }
 
+        /// 写入变长数据
+        [[nodiscard]] auto write_bytes(const std::vector<uint8_t>& _data) const -> IAsyncOperation<GattWriteResult> {
+            return characteristic.WriteValueWithResultAsync(to_buffer(_data), GattWriteOption::WriteWithResponse);
+        }
+
+        [[nodiscard]] auto write_bytes_no_response(const std::vector<uint8_t>& _data) const -> IAsyncOperation<GattCommunicationStatus> {
+            return characteristic.WriteValueAsync(to_buffer(_data), GattWriteOption::WriteWithoutResponse);
+        }
+
+        /// 向 CCCD 写入通知使能
+        [[nodiscard]] auto subscribe() const -> IAsyncOperation<GattCommunicationStatus> {
+            return characteristic.WriteClientCharacteristicConfigurationDescriptorAsync(GattClientCharacteristicConfigurationDescriptorValue::Notify);
+        }
+
         [[nodiscard]] auto register_value_changed(const TypedEventHandler<GattCharacteristic, GattValueChangedEventArgs>& _handler) const -> event_token {
             return characteristic.ValueChanged(_handler);
         }
 
+        auto unregister_value_changed(const event_token& _token) const -> void {
+            characteristic.ValueChanged(_token);
+        }
+
         [[nodiscard]] auto get_descriptor(const uint32_t _uuid) const -> std::optional<std::shared_ptr<Descriptor>> {
             for (const auto& d : descriptors) {
                 if (d->uuid().Data1 == _uuid) {
@@ -98,6 +116,12 @@ namespace ble {
             writer.WriteBytes(std::vector(reinterpret_cast<const uint8_t*>(&_data), reinterpret_cast<const uint8_t*>(&_data) + sizeof(T)));
             return writer.DetachBuffer();
         }
+
+        auto to_buffer(const std::vector<uint8_t>& _data) const {
+            const auto writer = Windows::Storage::Streams::DataWriter();
+            writer.WriteBytes(_data);
+            return writer.DetachBuffer();
+        }
     };
 
     class Service {
@@ -152,6 +176,19 @@ namespace ble {
             return device.BluetoothAddress();
         }
 
+        /**
+         * @brief 当前协商的 ATT MTU
+         * @return 单次写入可携带的最大字节数 + 3
+         */
+        [[nodiscard]] auto max_pdu_size() const -> uint16_t {
+            try {
+                const auto session = GattSession::FromDeviceIdAsync(device.BluetoothDeviceId()).get();
+                return session.MaxPduSize();
+            } catch (...) {
+                return 23;
+            }
+        }
+
         [[nodiscard]] auto get_service(const uint32_t _uuid) const -> std::optional<std::shared_ptr<Service>> {
             for (const auto& s : services) {
                 if (s->uuid().Data1 == _uuid) {
@@ -1,12 +1,243 @@
 ﻿#pragma once
 #include <BLE.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <numbers>
 #include <random>
+#include <string_view>
+#include <thread>
 
 namespace hid {
     using namespace std::chrono_literals;
     using namespace winrt::Windows::Devices::Bluetooth::GenericAttributeProfile;
 
+    /**
+     * @brief 主机与设备时钟同步
+     *
+     * NTP 式交换：主机写入 t1，设备记录收到时刻 t2 与回发时刻 t3，主机收到通知时记 t4。
+     * 保留最近的样本，只用往返时延接近最小值的样本做线性拟合，得到偏移与漂移；
+     * 不确定度为最小往返时延的一半加拟合残差。后台线程定期刷新。
+     */
+    class Clock {
+    public:
+        struct Estimate {
+            double offset_us = 0;       ///< 设备时间 - 主机时间（拟合基准时刻处）
+            double drift_ppm = 0;       ///< 设备时钟相对主机的频率偏差
+            double uncertainty_us = 0;  ///< 换算误差上界的估计
+            double min_rtt_us = 0;
+            size_t samples = 0;
+        };
+
+        Clock() = default;
+        Clock(const Clock&) = delete;
+        auto operator=(const Clock&) -> Clock& = delete;
+
+        ~Clock() {
+            stop();
+        }
+
+        /// 主机单调时钟(µs)
+        static auto now_us() -> int64_t {
+            return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /**
+         * @brief 订阅同步特征并启动后台刷新
+         * @param _period 样本充足后的刷新周期，刚启动时会更密集地采样
+         */
+        auto start(const std::shared_ptr<ble::Characteristic>& _char, const std::chrono::milliseconds _period = 1000ms) -> bool {
+            stop();
+            time_char = _char;
+            token = time_char->register_value_changed([this](const GattCharacteristic&, const GattValueChangedEventArgs& _args) {
+                const int64_t t4 = now_us();
+                const auto value = _args.CharacteristicValue();
+                if (value.Length() < sizeof(Reply)) {
+                    return;
+                }
+                Reply reply;
+                std::memcpy(&reply, value.data(), sizeof(reply));
+                on_reply(reply, t4);
+            });
+            if (time_char->subscribe().get() != GattCommunicationStatus::Success) {
+                return false;
+            }
+
+            worker = std::jthread([this, _period](const std::stop_token& _stop) {
+                while (!_stop.stop_requested()) {
+                    exchange();
+                    const auto wait = sample_count() < window / 2 ? 50ms : _period;
+                    std::unique_lock lock(mutex);
+                    stop_cv.wait_for(lock, _stop, wait, [] { return false; });
+                }
+            });
+            return true;
+        }
+
+        auto stop() -> void {
+            if (worker.joinable()) {
+                worker.request_stop();
+                worker.join();
+            }
+            if (time_char) {
+                time_char->unregister_value_changed(token);
+                time_char = nullptr;
+            }
+        }
+
+        /**
+         * @brief 完成一次交换
+         * @return 超时或写入失败返回 false
+         */
+        auto exchange(const std::chrono::milliseconds _timeout = 200ms) -> bool {
+            std::unique_lock lock(mutex);
+            const int64_t t1 = now_us();
+            waiting_t1 = t1;
+            lock.unlock();
+
+            if (time_char->write_no_response(t1).get() != GattCommunicationStatus::Success) {
+                return false;
+            }
+
+            lock.lock();
+            return replied.wait_for(lock, _timeout, [&] { return waiting_t1 != t1; });
+        }
+
+        [[nodiscard]] auto estimate() const -> std::optional<Estimate> {
+            std::lock_guard lock(mutex);
+            return current;
+        }
+
+        /// 把主机时刻换算为设备时刻，尚无估计时返回 nullopt
+        [[nodiscard]] auto to_device(const int64_t _host_us) const -> std::optional<int64_t> {
+            std::lock_guard lock(mutex);
+            if (!current) {
+                return std::nullopt;
+            }
+            const double dt = static_cast<double>(_host_us - base_host);
+            return _host_us + static_cast<int64_t>(std::llround(current->offset_us + dt * current->drift_ppm * 1e-6));
+        }
+
+        [[nodiscard]] auto to_host(const int64_t _device_us) const -> std::optional<int64_t> {
+            std::lock_guard lock(mutex);
+            if (!current) {
+                return std::nullopt;
+            }
+            const double k = 1.0 + current->drift_ppm * 1e-6;
+            const double host = (static_cast<double>(_device_us) - current->offset_us + base_host * (k - 1.0)) / k;
+            return static_cast<int64_t>(std::llround(host));
+        }
+
+    private:
+#pragma pack(push, 1)
+        struct Reply {
+            int64_t t1;
+            int64_t t2;
+            int64_t t3;
+        };
+#pragma pack(pop)
+
+        struct Sample {
+            int64_t host_us;  ///< 主机侧中点 (t1 + t4) / 2
+            double offset_us;
+            double rtt_us;
+        };
+
+        static constexpr size_t window = 32;
+
+        std::shared_ptr<ble::Characteristic> time_char;
+        winrt::event_token token{};
+        std::jthread worker;
+
+        mutable std::mutex mutex;
+        std::condition_variable replied;
+        std::condition_variable_any stop_cv;
+        int64_t waiting_t1 = 0;
+        std::deque<Sample> samples;
+        std::optional<Estimate> current;
+        int64_t base_host = 0;
+
+        auto sample_count() const -> size_t {
+            std::lock_guard lock(mutex);
+            return samples.size();
+        }
+
+        auto on_reply(const Reply& _reply, const int64_t _t4) -> void {
+            std::lock_guard lock(mutex);
+            if (_reply.t1 != waiting_t1) {
+                return;
+            }
+            waiting_t1 = 0;
+
+            Sample sample;
+            sample.host_us = (_reply.t1 + _t4) / 2;
+            sample.offset_us = ((_reply.t2 - _reply.t1) + (_reply.t3 - _t4)) / 2.0;
+            sample.rtt_us = static_cast<double>((_t4 - _reply.t1) - (_reply.t3 - _reply.t2));
+            samples.push_back(sample);
+            if (samples.size() > window) {
+                samples.pop_front();
+            }
+            refit();
+            replied.notify_all();
+        }
+
+        /// 只用往返时延接近最小值的样本拟合 offset = a + b * (t - base)
+        auto refit() -> void {
+            const double min_rtt = std::ranges::min(samples, {}, &Sample::rtt_us).rtt_us;
+            const double limit = min_rtt * 1.5 + 200.0;
+
+            std::vector<const Sample*> good;
+            for (const auto& s : samples) {
+                if (s.rtt_us <= limit) {
+                    good.push_back(&s);
+                }
+            }
+
+            base_host = good.back()->host_us;
+            double a = good.back()->offset_us;
+            double b = 0;
+            if (good.size() >= 4) {
+                double sx = 0, sy = 0, sxx = 0, sxy = 0;
+                for (const auto* s : good) {
+                    const double x = static_cast<double>(s->host_us - base_host);
+                    sx += x;
+                    sy += s->offset_us;
+                    sxx += x * x;
+                    sxy += x * s->offset_us;
+                }
+                const double n = static_cast<double>(good.size());
+                const double den = n * sxx - sx * sx;
+                if (den > 0) {
+                    b = (n * sxy - sx * sy) / den;
+                    a = (sy - b * sx) / n;
+                }
+            }
+
+            double residual = 0;
+            for (const auto* s : good) {
+                const double e = s->offset_us - (a + b * static_cast<double>(s->host_us - base_host));
+                residual += e * e;
+            }
+            residual = std::sqrt(residual / static_cast<double>(good.size()));
+
+            current = Estimate{
+                    .offset_us = a,
+                    .drift_ppm = b * 1e6,
+                    .uncertainty_us = min_rtt / 2.0 + residual,
+                    .min_rtt_us = min_rtt,
+                    .samples = good.size(),
+            };
+        }
+    };
+
     class Mouse {
     public:
         static auto connect(const uint64_t _address) -> bool {
@@ -34,9 +265,321 @@ namespace hid {
             click_char = char_click.value();
             move_char = char_move.value();
             wheel_char = char_wheel.value();
+            batch_char = service.value()->get_characteristic(0xEF04).value_or(nullptr);
+            stats_char = service.value()->get_characteristic(0xEF05).value_or(nullptr);
+            timed_char = service.value()->get_characteristic(0xEF06).value_or(nullptr);
+            move_to_char = service.value()->get_characteristic(0xEF08).value_or(nullptr);
+            move_fine_char = service.value()->get_characteristic(0xEF09).value_or(nullptr);
+            text_char = service.value()->get_characteristic(0xEF0A).value_or(nullptr);
+            button_char = service.value()->get_characteristic(0xEF0B).value_or(nullptr);
+            probe_char = service.value()->get_characteristic(0xEF0C).value_or(nullptr);
+            probe_result_char = service.value()->get_characteristic(0xEF0D).value_or(nullptr);
+            latency_char = service.value()->get_characteristic(0xEF0E).value_or(nullptr);
+            device = devices;
+            next_seq = 0;
+
+            clock.stop();
+            if (const auto char_time = service.value()->get_characteristic(0xEF07)) {
+                clock.start(char_time.value());
+            }
             return true;
         }
 
+        /// 设备时钟同步状态，固件不支持时始终没有估计值
+        static auto get_clock() -> const Clock& {
+            return clock;
+        }
+
+        /// 主机当前时刻对应的设备时刻
+        static auto device_now() -> std::optional<int64_t> {
+            return clock.to_device(Clock::now_us());
+        }
+
+        /**
+         * @brief 低延迟模式：命令改用无响应写入，不再等待每条命令的确认往返
+         *
+         * 固件支持时每条命令附带序号，丢失与拒绝情况通过 subscribe_stats 观察。
+         */
+        static auto set_low_latency(const bool _enable) -> void {
+            low_latency = _enable;
+        }
+
+#pragma pack(push, 1)
+        /// 设备端序号统计，与固件 Event::STATS_Data 一致
+        struct Stats {
+            uint32_t received = 0;  ///< 收到的带序号命令数
+            uint32_t lost = 0;      ///< 按跳号推算的丢失条数
+            uint32_t gaps = 0;      ///< 跳号次数
+            uint32_t stale = 0;     ///< 重复或乱序
+            uint32_t busy = 0;      ///< 设备输入队列满被拒绝的命令数
+            uint16_t last_seq = 0;
+            uint32_t timed = 0;          ///< 已执行的定时命令数
+            uint32_t timed_late = 0;     ///< 超过设备迟到阈值的定时命令数
+            uint32_t timed_dropped = 0;  ///< 设备定时队列已满被丢弃的命令数
+            uint32_t max_late_us = 0;
+            uint32_t avg_late_us = 0;
+            uint32_t keys = 0;             ///< 已发出的按键数
+            uint32_t keys_per_second = 0;  ///< 最近一秒的按键速率
+            uint32_t text_unmapped = 0;    ///< 无法映射为按键的字符数
+        };
+
+        /// 定时输入，与固件 Event::TIMED_Entry 一致
+        struct Timed {
+            int64_t at_us = 0;  ///< 设备时钟下的执行时刻(µs)
+            int16_t x = 0;
+            int16_t y = 0;
+            int8_t wheel = 0;
+            uint8_t button = 0;
+        };
+#pragma pack(pop)
+
+        /// 读取当前统计
+        static auto get_stats() -> std::optional<Stats> {
+            if (!stats_char) {
+                return std::nullopt;
+            }
+            const auto result = stats_char->read().get();
+            if (result.Status() != GattCommunicationStatus::Success) {
+                return std::nullopt;
+            }
+            return parse_stats(result.Value());
+        }
+
+        /**
+         * @brief 订阅统计通知，设备在出现跳号、拒绝或每 64 条命令时推送
+         * @return 是否订阅成功
+         */
+        static auto subscribe_stats(std::function<void(const Stats&)> _handler) -> bool {
+            if (!stats_char) {
+                return false;
+            }
+            stats_token = stats_char->register_value_changed([_handler](const GattCharacteristic&, const GattValueChangedEventArgs& _args) {
+                if (const auto stats = parse_stats(_args.CharacteristicValue())) {
+                    _handler(*stats);
+                }
+            });
+            return stats_char->subscribe().get() == GattCommunicationStatus::Success;
+        }
+
+        /// 一组延迟分位数(µs)
+        struct Percentiles {
+            int64_t p50 = 0;
+            int64_t p99 = 0;
+            int64_t p999 = 0;
+        };
+
+        /// measure_latency 的结果，设备阶段使用设备时钟，不受时钟同步误差影响
+        struct Latency {
+            uint32_t samples = 0;  ///< 收到结果的探针数
+            uint32_t lost = 0;     ///< 超时未收到结果的探针数
+            Percentiles rtt;       ///< 主机写入到收到结果通知
+            Percentiles queue;     ///< 设备收到写入到输入任务取出
+            Percentiles emit;      ///< 输入任务取出到 HID 报告交给协议栈
+            Percentiles total;     ///< 设备收到写入到 HID 报告交给协议栈
+            Percentiles report;    ///< 主机写入到 HID 报告交给协议栈，需要时钟同步，否则为 0
+        };
+
+        /**
+         * @brief 用延迟探针测量 n 次端到端延迟，打印并返回各阶段 p50/p99/p999
+         *
+         * 每个探针附带 ±1 像素的交替位移，保证设备端有一帧报告可测，净位移为 0。
+         * 探针串行发出，前一个结果返回或超时后才发下一个。
+         * @param _n 探针数
+         * @param _timeout 单个探针等待结果的时长
+         */
+        static auto measure_latency(const uint32_t _n, const std::chrono::milliseconds _timeout = 200ms) -> std::optional<Latency> {
+            if (!probe_char || !probe_result_char) {
+                return std::nullopt;
+            }
+
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::optional<ProbeResult> result;
+            uint32_t waiting = 0;
+            const auto token = probe_result_char->register_value_changed([&](const GattCharacteristic&, const GattValueChangedEventArgs& _args) {
+                const int64_t now = Clock::now_us();
+                const auto value = _args.CharacteristicValue();
+                if (value.Length() < offsetof(ProbeResult, host_rx_us)) {
+                    return;
+                }
+                ProbeResult r;
+                std::memcpy(&r, value.data(), offsetof(ProbeResult, host_rx_us));
+                std::lock_guard lock(mutex);
+                if (r.id == waiting) {
+                    r.host_rx_us = now;
+                    result = r;
+                    cv.notify_one();
+                }
+            });
+            if (probe_result_char->subscribe().get() != GattCommunicationStatus::Success) {
+                probe_result_char->unregister_value_changed(token);
+                return std::nullopt;
+            }
+
+            std::vector<int64_t> rtt, queue, emit, total, report;
+            Latency latency;
+            for (uint32_t i = 1; i <= _n; ++i) {
+                const Probe probe{i, static_cast<int16_t>(i & 1 ? 1 : -1), 0};
+                {
+                    std::lock_guard lock(mutex);
+                    waiting = i;
+                    result.reset();
+                }
+                const int64_t sent = Clock::now_us();
+                const auto* raw = reinterpret_cast<const uint8_t*>(&probe);
+                if (probe_char->write_bytes_no_response(std::vector<uint8_t>(raw, raw + sizeof(probe))).get() != GattCommunicationStatus::Success) {
+                    ++latency.lost;
+                    continue;
+                }
+
+                std::unique_lock lock(mutex);
+                if (!cv.wait_for(lock, _timeout, [&] { return result.has_value(); })) {
+                    ++latency.lost;
+                    continue;
+                }
+                const ProbeResult r = *result;
+                lock.unlock();
+
+                rtt.push_back(r.host_rx_us - sent);
+                queue.push_back(r.dequeue_us - r.rx_us);
+                emit.push_back(r.emit_us - r.dequeue_us);
+                total.push_back(r.emit_us - r.rx_us);
+                if (const auto host_emit = clock.to_host(r.emit_us)) {
+                    report.push_back(*host_emit - sent);
+                }
+            }
+            probe_result_char->unregister_value_changed(token);
+
+            latency.samples = static_cast<uint32_t>(rtt.size());
+            latency.rtt = percentiles(rtt);
+            latency.queue = percentiles(queue);
+            latency.emit = percentiles(emit);
+            latency.total = percentiles(total);
+            latency.report = percentiles(report);
+
+            std::printf("latency: %u samples, %u lost (us)\n", latency.samples, latency.lost);
+            const auto print = [](const char* _name, const Percentiles& _p) {
+                std::printf("  %-8s p50 %7lld  p99 %7lld  p999 %7lld\n", _name, static_cast<long long>(_p.p50), static_cast<long long>(_p.p99), static_cast<long long>(_p.p999));
+            };
+            print("rtt", latency.rtt);
+            print("queue", latency.queue);
+            print("emit", latency.emit);
+            print("total", latency.total);
+            if (!report.empty()) {
+                print("report", latency.report);
+            }
+            return latency;
+        }
+
+        /// 设备端累计的延迟直方图，与固件 Event::LATENCY_Data 一致，第 i 桶为 [2^(i-1), 2^i) µs
+        struct LatencyHistogram {
+            uint32_t queue[24] = {};
+            uint32_t emit[24] = {};
+            uint32_t total[24] = {};
+        };
+
+        /// 读取设备端延迟直方图
+        static auto get_latency_histogram() -> std::optional<LatencyHistogram> {
+            if (!latency_char) {
+                return std::nullopt;
+            }
+            const auto result = latency_char->read().get();
+            if (result.Status() != GattCommunicationStatus::Success || result.Value().Length() < sizeof(LatencyHistogram)) {
+                return std::nullopt;
+            }
+            LatencyHistogram histogram;
+            std::memcpy(&histogram, result.Value().data(), sizeof(histogram));
+            return histogram;
+        }
+
+#pragma pack(push, 1)
+        /// 批量输入样本，与固件 Event::BATCH_Sample 一致
+        struct Sample {
+            int16_t x = 0;
+            int16_t y = 0;
+            int8_t wheel = 0;
+            uint8_t button = 0;  ///< 本样本要点击的按键掩码
+            uint16_t delay_us = 0;  ///< 执行完本样本后设备端等待的时长
+        };
+#pragma pack(pop)
+
+        /**
+         * @brief 批量发送输入样本，按当前 MTU 打包，每次写入携带尽可能多的样本
+         * @param _samples 按顺序执行的样本
+         * @return 是否全部发送成功
+         */
+        static auto move_batch(const std::vector<Sample>& _samples) -> bool {
+            if (!batch_char) {
+                for (const auto& s : _samples) {
+                    if (!move(s.x, s.y)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            const bool has_delay = std::ranges::any_of(_samples, [](const Sample& s) { return s.delay_us != 0; });
+            const size_t stride = has_delay ? sizeof(Sample) : sizeof(Sample) - sizeof(uint16_t);
+            const size_t payload = std::max<size_t>(device->max_pdu_size(), 23) - 3 - 2 - (sequenced() ? sizeof(uint16_t) : 0);
+            const size_t per_write = std::min<size_t>(payload / stride, 255);
+
+            for (size_t begin = 0; begin < _samples.size(); begin += per_write) {
+                const size_t count = std::min(per_write, _samples.size() - begin);
+                std::vector<uint8_t> buffer;
+                buffer.reserve(2 + count * stride);
+                buffer.push_back(static_cast<uint8_t>(count));
+                buffer.push_back((has_delay ? batch_delay : 0) | (sequenced() ? batch_seq : 0));
+                for (size_t i = begin; i < begin + count; ++i) {
+                    const auto* raw = reinterpret_cast<const uint8_t*>(&_samples[i]);
+                    buffer.insert(buffer.end(), raw, raw + stride);
+                }
+                if (sequenced()) {
+                    const uint16_t seq = next_seq++;
+                    buffer.push_back(static_cast<uint8_t>(seq));
+                    buffer.push_back(static_cast<uint8_t>(seq >> 8));
+                }
+                if (!write(batch_char, buffer)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief 按设备时钟定时执行输入，时间精度取决于设备而不是主机或链路
+         * @param _entries 定时输入，at_us 早于设备当前时间的会立即执行并计为迟到
+         * @return 是否全部发送成功，旧固件不支持时返回 false
+         */
+        static auto schedule(const std::vector<Timed>& _entries) -> bool {
+            if (!timed_char) {
+                return false;
+            }
+
+            const size_t payload = std::max<size_t>(device->max_pdu_size(), 23) - 3 - 2 - sizeof(uint16_t);
+            const size_t per_write = std::min<size_t>(payload / sizeof(Timed), 255);
+            for (size_t begin = 0; begin < _entries.size(); begin += per_write) {
+                const size_t count = std::min(per_write, _entries.size() - begin);
+                std::vector<uint8_t> buffer;
+                buffer.reserve(2 + count * sizeof(Timed) + sizeof(uint16_t));
+                buffer.push_back(static_cast<uint8_t>(count));
+                buffer.push_back(batch_seq);
+                const auto* raw = reinterpret_cast<const uint8_t*>(_entries.data() + begin);
+                buffer.insert(buffer.end(), raw, raw + count * sizeof(Timed));
+                const uint16_t seq = next_seq++;
+                buffer.push_back(static_cast<uint8_t>(seq));
+                buffer.push_back(static_cast<uint8_t>(seq >> 8));
+                if (!write(timed_char, buffer)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// 在设备时钟 _at_us 时刻移动鼠标
+        static auto move_at(const int16_t _x, const int16_t _y, const int64_t _at_us) -> bool {
+            return schedule({Timed{.at_us = _at_us, .x = _x, .y = _y}});
+        }
+
         /**
          * @brief 移动鼠标
          * @param _x 水平方向相对像素（正=右，负=左）
@@ -47,8 +590,45 @@ namespace hid {
             Move data;
             data.x = _x;
             data.y = _y;
-            const auto result = move_char->write(data).get();
-            return result.Status() == GattCommunicationStatus::Success;
+            return send(move_char, data);
+        }
+
+        /**
+         * @brief 亚像素相对移动，设备端以 1/256 像素累积余量，连续的小数位移不会因取整丢失
+         * @return 是否成功发送，旧固件退化为取整后的 move
+         */
+        static auto move_fine(const double _x, const double _y) -> bool {
+            if (!move_fine_char) {
+                fine_rest_x += _x;
+                fine_rest_y += _y;
+                const int mx = static_cast<int>(fine_rest_x);
+                const int my = static_cast<int>(fine_rest_y);
+                fine_rest_x -= mx;
+                fine_rest_y -= my;
+                return mx == 0 && my == 0 ? true : move(mx, my);
+            }
+            MoveFine data;
+            data.x = static_cast<int32_t>(std::llround(_x * 256.0));
+            data.y = static_cast<int32_t>(std::llround(_y * 256.0));
+            return send(move_fine_char, data);
+        }
+
+        /**
+         * @brief 把指针直接放到主屏幕上的指定位置，一次写入、一帧绝对坐标报告
+         * @param _x 主屏幕像素坐标
+         * @param _y 主屏幕像素坐标
+         * @return 是否成功发送，旧固件不支持时返回 false
+         */
+        static auto move_to(const int _x, const int _y) -> bool {
+            if (!move_to_char) {
+                return false;
+            }
+            const int cx = std::max(GetSystemMetrics(SM_CXSCREEN) - 1, 1);
+            const int cy = std::max(GetSystemMetrics(SM_CYSCREEN) - 1, 1);
+            MoveTo data;
+            data.x = static_cast<uint16_t>(std::clamp(_x, 0, cx) * absolute_max / cx);
+            data.y = static_cast<uint16_t>(std::clamp(_y, 0, cy) * absolute_max / cy);
+            return send(move_to_char, data);
         }
 
         /**
@@ -88,6 +668,11 @@ namespace hid {
             const double nx = -dy / dist;
             const double ny = dx / dist;
             double px = x0, py = y0;
+
+            // 时钟已同步时整条轨迹按设备时刻一次下发，由设备定时执行，主机与链路抖动不再进入输出
+            std::vector<Timed> timed;
+            const auto device_start = timed_char ? clock.to_device(Clock::now_us() + lead_us()) : std::nullopt;
+            int64_t elapsed_us = 0;
             for (int i = 1; i <= steps; ++i) {
                 const double t = i / static_cast<double>(steps);
                 auto [bx, by] = bezier(t);
@@ -98,50 +683,201 @@ namespace hid {
                 bx += rand_real(-1, 1);
                 by += rand_real(-1, 1);
 
+                // 按已发送的整数位移推进，取整误差留给下一段而不是丢掉
                 const int mx = static_cast<int>(std::round(bx - px));
                 const int my = static_cast<int>(std::round(by - py));
-                move(mx, my);
-                px = bx;
-                py = by;
+                px += mx;
+                py += my;
 
                 const double ratio = 1.0 - std::cos(t * std::numbers::pi) * 0.3;
                 int delay = static_cast<int>(base_delay * ratio);
+                if (device_start) {
+                    timed.push_back({.at_us = *device_start + elapsed_us, .x = static_cast<int16_t>(mx), .y = static_cast<int16_t>(my)});
+                    elapsed_us += delay + 1000;
+                    continue;
+                }
+
+                move(mx, my);
                 std::this_thread::sleep_for(std::chrono::microseconds(delay));
                 std::this_thread::sleep_for(1ms);
             }
+
+            if (!timed.empty()) {
+                schedule(timed);
+            }
         }
 
         static auto click(const uint8_t _button) -> bool {
             Click data;
             data.button = 1 << _button;
-            const auto result = click_char->write(data).get();
-            return result.Status() == GattCommunicationStatus::Success;
+            return send(click_char, data);
+        }
+
+        /**
+         * @brief 按住按键，直到 release；期间的移动即为拖拽
+         * @return 是否成功发送，旧固件不支持时返回 false
+         */
+        static auto press(const uint8_t _button) -> bool {
+            return button(button_press, _button);
+        }
+
+        static auto release(const uint8_t _button) -> bool {
+            return button(button_release, _button);
         }
 
         static auto wheel(const int8_t _v) -> bool {
             Wheel data;
             data.wheel = _v;
-            const auto result = wheel_char->write(data).get();
-            return result.Status() == GattCommunicationStatus::Success;
+            return send(wheel_char, data);
         }
 
     private:
+        friend class Keyboard;
+
+#pragma pack(push, 1)
+        // 末尾的 seq 仅在固件支持序号时发送
         struct Move {
             int x = 0;
             int y = 0;
+            uint16_t seq = 0;
         };
 
         struct Click {
             uint16_t button = 0;
+            uint16_t seq = 0;
         };
 
         struct Wheel {
             int8_t wheel = 0;
+            uint16_t seq = 0;
+        };
+
+        struct Button {
+            uint8_t action = 0;
+            uint8_t button = 0;
+            uint16_t seq = 0;
+        };
+
+        struct MoveFine {
+            int32_t x = 0;  ///< Q8 定点
+            int32_t y = 0;
+            uint16_t seq = 0;
+        };
+
+        struct MoveTo {
+            uint16_t x = 0;
+            uint16_t y = 0;
+            uint16_t seq = 0;
+        };
+
+        struct Probe {
+            uint32_t id = 0;
+            int16_t x = 0;
+            int16_t y = 0;
+        };
+
+        // 与固件 Event::PROBE_Result 一致，host_rx_us 为主机收到通知的时刻，不在线上传输
+        struct ProbeResult {
+            uint32_t id = 0;
+            int64_t rx_us = 0;
+            int64_t dequeue_us = 0;
+            int64_t emit_us = 0;
+            int64_t host_rx_us = 0;
         };
+#pragma pack(pop)
 
         inline static std::shared_ptr<ble::Characteristic> move_char;
         inline static std::shared_ptr<ble::Characteristic> click_char;
         inline static std::shared_ptr<ble::Characteristic> wheel_char;
+        inline static std::shared_ptr<ble::Characteristic> batch_char;
+        inline static std::shared_ptr<ble::Characteristic> timed_char;
+        inline static std::shared_ptr<ble::Characteristic> move_to_char;
+        inline static std::shared_ptr<ble::Characteristic> move_fine_char;
+        inline static std::shared_ptr<ble::Characteristic> text_char;
+        inline static std::shared_ptr<ble::Characteristic> button_char;
+        inline static std::shared_ptr<ble::Characteristic> probe_char;
+        inline static std::shared_ptr<ble::Characteristic> probe_result_char;
+        inline static std::shared_ptr<ble::Characteristic> latency_char;
+        inline static double fine_rest_x = 0;
+        inline static double fine_rest_y = 0;
+        inline static std::shared_ptr<ble::Characteristic> stats_char;
+        inline static std::shared_ptr<ble::Devices> device;
+        inline static Clock clock;
+        inline static winrt::event_token stats_token;
+        inline static std::atomic<uint16_t> next_seq = 0;
+        inline static std::atomic<bool> low_latency = false;
+
+        static constexpr uint8_t batch_delay = 0x01;
+        static constexpr uint8_t batch_seq = 0x02;
+        static constexpr int absolute_max = 32767;
+
+        static auto percentiles(std::vector<int64_t>& _values) -> Percentiles {
+            if (_values.empty()) {
+                return {};
+            }
+            std::ranges::sort(_values);
+            const auto at = [&](const double _q) {
+                return _values[std::min(_values.size() - 1, static_cast<size_t>(std::ceil(_q * _values.size())) - 1)];
+            };
+            return {at(0.5), at(0.99), at(0.999)};
+        }
+
+        static auto parse_stats(const winrt::Windows::Storage::Streams::IBuffer& _value) -> std::optional<Stats> {
+            // 旧固件的统计较短，缺少的字段保持为 0
+            if (_value.Length() < offsetof(Stats, timed)) {
+                return std::nullopt;
+            }
+            Stats stats;
+            std::memcpy(&stats, _value.data(), std::min<size_t>(_value.Length(), sizeof(stats)));
+            return stats;
+        }
+
+        static constexpr uint8_t button_press = 0x00;
+        static constexpr uint8_t button_release = 0x01;
+
+        static auto button(const uint8_t _action, const uint8_t _button) -> bool {
+            if (!button_char) {
+                return false;
+            }
+            Button data;
+            data.action = _action;
+            data.button = 1 << _button;
+            return send(button_char, data);
+        }
+
+        /// 定时命令提前量：留出一次写入的链路时延与时钟误差
+        static auto lead_us() -> int64_t {
+            const auto estimate = clock.estimate();
+            if (!estimate) {
+                return 0;
+            }
+            return static_cast<int64_t>(estimate->min_rtt_us + estimate->uncertainty_us * 2) + 2000;
+        }
+
+        /// 固件带统计特征即支持序号
+        static auto sequenced() -> bool {
+            return stats_char != nullptr;
+        }
+
+        static auto write(const std::shared_ptr<ble::Characteristic>& _char, const std::vector<uint8_t>& _buffer) -> bool {
+            if (low_latency) {
+                return _char->write_bytes_no_response(_buffer).get() == GattCommunicationStatus::Success;
+            }
+            return _char->write_bytes(_buffer).get().Status() == GattCommunicationStatus::Success;
+        }
+
+        /// 填入序号后发送，旧固件不带序号
+        template<typename T>
+        static auto send(const std::shared_ptr<ble::Characteristic>& _char, T& _data) -> bool {
+            size_t len = sizeof(T);
+            if (sequenced()) {
+                _data.seq = next_seq++;
+            } else {
+                len -= sizeof(_data.seq);
+            }
+            const auto* raw = reinterpret_cast<const uint8_t*>(&_data);
+            return write(_char, std::vector<uint8_t>(raw, raw + len));
+        }
 
         static auto rng() -> std::mt19937& {
             static std::mt19937 e{std::random_device{}()};
@@ -160,4 +896,95 @@ namespace hid {
             return static_cast<T>(d(rng()));
         }
     };
+    /**
+     * @brief 键盘文本输入，复用 Mouse::connect 建立的连接
+     *
+     * 设备端把文本转换为按键并流水线发出，每帧尽量多按下互不相同的键。
+     */
+    class Keyboard {
+    public:
+        /**
+         * @brief 输入 UTF-8 文本，按 MTU 分段写入；设备只能输入 ASCII，其余字符计入 Mouse::Stats::text_unmapped
+         * @return 是否全部写入成功，固件不支持时返回 false
+         */
+        static auto type(const std::string_view _text) -> bool {
+            return write(text_utf8, std::vector<uint8_t>(_text.begin(), _text.end()), 1);
+        }
+
+        /// 直接发送 (修饰键, 用法码) 序列
+        static auto keys(const std::vector<std::pair<uint8_t, uint8_t>>& _keys) -> bool {
+            std::vector<uint8_t> bytes;
+            bytes.reserve(_keys.size() * 2);
+            for (const auto& [modifier, usage] : _keys) {
+                bytes.push_back(modifier);
+                bytes.push_back(usage);
+            }
+            return write(text_keycodes, bytes, 2);
+        }
+
+    private:
+        static constexpr uint8_t text_utf8 = 0x00;
+        static constexpr uint8_t text_keycodes = 0x01;
+        static constexpr uint8_t text_seq = 0x80;
+        /// 每次写入的最多按键数：设备键盘缓冲区 256 键，每帧只能发出几个，分小段写入便于流水线
+        static constexpr size_t max_keys_per_write = 64;
+        /// 设备回 ESP_GATT_BUSY 时整段未入队，等待缓冲区腾出后重发
+        static constexpr uint8_t gatt_busy = 0x84;
+        static constexpr auto busy_retry = 20ms;
+        static constexpr auto busy_timeout = 5000ms;
+
+        /// 分段写入，_unit 为不可拆分的最小单位；UTF-8 按字符边界切分
+        static auto write(const uint8_t _mode, const std::vector<uint8_t>& _data, const size_t _unit) -> bool {
+            if (!Mouse::text_char) {
+                return false;
+            }
+            const bool sequenced = Mouse::sequenced();
+            const size_t payload = std::min(std::max<size_t>(Mouse::device->max_pdu_size(), 23) - 3 - 1 - (sequenced ? sizeof(uint16_t) : 0), max_keys_per_write * _unit);
+
+            for (size_t begin = 0; begin < _data.size();) {
+                size_t end = std::min(begin + payload / _unit * _unit, _data.size());
+                if (_mode == text_utf8) {
+                    while (end < _data.size() && end > begin && (_data[end] & 0xC0) == 0x80) {
+                        --end;
+                    }
+                }
+
+                std::vector<uint8_t> buffer;
+                buffer.reserve(1 + end - begin + sizeof(uint16_t));
+                buffer.push_back(_mode | (sequenced ? text_seq : 0));
+                buffer.insert(buffer.end(), _data.begin() + begin, _data.begin() + end);
+                if (sequenced) {
+                    const uint16_t seq = Mouse::next_seq++;
+                    buffer.push_back(static_cast<uint8_t>(seq));
+                    buffer.push_back(static_cast<uint8_t>(seq >> 8));
+                }
+                if (!write_chunk(buffer, sequenced)) {
+                    return false;
+                }
+                begin = end;
+            }
+            return true;
+        }
+
+        /// 带响应写入一段，设备忙时换新序号重试；文本必须能看到背压，不受低延迟模式影响
+        static auto write_chunk(std::vector<uint8_t>& _buffer, const bool _sequenced) -> bool {
+            const auto deadline = std::chrono::steady_clock::now() + busy_timeout;
+            while (true) {
+                const auto result = Mouse::text_char->write_bytes(_buffer).get();
+                if (result.Status() == GattCommunicationStatus::Success) {
+                    return true;
+                }
+                const auto error = result.ProtocolError();
+                if (result.Status() != GattCommunicationStatus::ProtocolError || !error || error.Value() != gatt_busy || std::chrono::steady_clock::now() >= deadline) {
+                    return false;
+                }
+                std::this_thread::sleep_for(busy_retry);
+                if (_sequenced) {
+                    const uint16_t seq = Mouse::next_seq++;
+                    _buffer[_buffer.size() - 2] = static_cast<uint8_t>(seq);
+                    _buffer[_buffer.size() - 1] = static_cast<uint8_t>(seq >> 8);
+                }
+            }
+        }
+    };
 }
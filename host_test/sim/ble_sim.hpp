@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+
+/**
+ * @brief 进程内的 Bluedroid 替身
+ *
+ * esp_ble_gatts_* / esp_ble_gap_* 调用产生的事件(REG、CREATE、ADD_CHAR、参数更新、DLE 完成等)与测试注入的
+ * 对端事件放进同一个队列，由 run() 在调用线程上依次分发给已注册的回调，相当于 BTC 任务。
+ * 发出的通知与响应都被记录下来供测试检查。除 run() 外的函数任意线程可调用。
+ */
+namespace sim {
+    struct Notification {
+        esp_gatt_if_t gatts_if;
+        uint16_t conn_id;
+        uint16_t handle;
+        bool need_confirm;
+        std::vector<uint8_t> value;
+    };
+
+    struct Response {
+        esp_gatt_if_t gatts_if;
+        uint16_t conn_id;
+        uint32_t trans_id;
+        esp_gatt_status_t status;
+        std::vector<uint8_t> value;  // 读响应的内容，写响应为空
+    };
+
+    /// 协议栈分配的属性
+    struct Attribute {
+        esp_gatt_if_t gatts_if;
+        uint16_t service_uuid;
+        uint16_t service_handle;
+        uint16_t handle;
+        uint16_t uuid;
+        uint16_t char_handle;  // 描述符所属特征的句柄，特征本身为 0
+    };
+
+    /// 分发队列中的事件直到队列为空，返回分发的事件数；只能在一个线程中调用
+    auto run() -> size_t;
+
+    auto inject(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, const esp_ble_gatts_cb_param_t& param) -> void;
+    auto inject(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t& param) -> void;
+
+    /// 对端连入，和真实协议栈一样给每个已注册的应用各投递一次 CONNECT
+    auto connect(uint16_t conn_id, const esp_bd_addr_t bda, uint16_t interval = 6) -> void;
+    auto disconnect(uint16_t conn_id) -> void;
+    /// 对端写属性，need_rsp 为 false 时相当于无响应写入；返回事务号
+    auto write(uint16_t conn_id, uint16_t handle, std::span<const uint8_t> value, bool need_rsp = true) -> uint32_t;
+    auto read(uint16_t conn_id, uint16_t handle, uint16_t offset = 0) -> uint32_t;
+    auto congest(uint16_t conn_id, bool congested) -> void;
+    /// 控制器空闲的发送缓冲数，为 0 时 esp_ble_get_cur_sendable_packets_num 报告链路忙
+    auto set_sendable(uint16_t packets) -> void;
+
+    auto attributes() -> std::vector<Attribute>;
+    /// 按 UUID 找第 index 个特征的句柄，找不到返回 0
+    auto find_char(uint16_t uuid, size_t index = 0) -> uint16_t;
+    /// 找特征下指定 UUID 的描述符句柄，找不到返回 0
+    auto find_descr(uint16_t char_handle, uint16_t uuid) -> uint16_t;
+
+    /// 取走目前记录的通知/响应
+    auto take_notifications() -> std::vector<Notification>;
+    auto take_responses() -> std::vector<Response>;
+
+    /**
+     * @brief 等到记录的通知达到 count 条或超时，期间持续分发事件
+     * @return 取走的全部通知，超时时可能少于 count
+     */
+    auto wait_notifications(size_t count, std::chrono::milliseconds timeout) -> std::vector<Notification>;
+
+    /// 停止 esp_timer 分发线程，测试结束前调用
+    auto shutdown() -> void;
+} // namespace sim
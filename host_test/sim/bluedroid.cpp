@@ -0,0 +1,447 @@
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "ble_sim.hpp"
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gatt_common_api.h"
+#include "esp_timer.h"
+
+namespace {
+    struct Event {
+        bool gap;
+        esp_gatts_cb_event_t gatts_event;
+        esp_gatt_if_t gatts_if;
+        esp_ble_gatts_cb_param_t gatts_param;
+        esp_gap_ble_cb_event_t gap_event;
+        esp_ble_gap_cb_param_t gap_param;
+        std::vector<uint8_t> payload;  // 写入内容，分发时再把 write.value 指向它
+    };
+
+    struct Service {
+        esp_gatt_if_t gatts_if;
+        uint16_t uuid;
+        uint16_t handle;
+        uint16_t end;
+        uint16_t next;
+    };
+
+    struct Link {
+        uint16_t conn_id;
+        esp_bd_addr_t bda;
+    };
+
+    // 协议栈状态，全部由 lock 保护；回调分发时不持锁
+    std::mutex lock;
+    std::deque<Event> events;
+    esp_gatts_cb_t gatts_cb = nullptr;
+    esp_gap_ble_cb_t gap_cb = nullptr;
+    std::vector<esp_gatt_if_t> apps;
+    std::vector<Service> services;
+    std::vector<sim::Attribute> attrs;
+    std::vector<Link> links;
+    std::vector<sim::Notification> notifications;
+    std::vector<sim::Response> responses;
+    uint16_t next_handle = 40;
+    uint16_t sendable = 8;
+    uint32_t next_trans_id = 1;
+
+    auto push_gatts(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, const esp_ble_gatts_cb_param_t& param, std::span<const uint8_t> payload = {}) -> void {
+        Event e{};
+        e.gatts_event = event;
+        e.gatts_if = gatts_if;
+        e.gatts_param = param;
+        e.payload.assign(payload.begin(), payload.end());
+        events.push_back(std::move(e));
+    }
+
+    auto push_gap(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t& param) -> void {
+        Event e{};
+        e.gap = true;
+        e.gap_event = event;
+        e.gap_param = param;
+        events.push_back(std::move(e));
+    }
+
+    auto find_service(uint16_t service_handle) -> Service* {
+        auto it = std::ranges::find(services, service_handle, &Service::handle);
+        return it != services.end() ? &*it : nullptr;
+    }
+
+    /// 属性句柄所在服务的应用，对端读写事件投递给它
+    auto owner_of(uint16_t handle) -> esp_gatt_if_t {
+        auto it = std::ranges::find_if(services, [handle](const Service& s) { return handle >= s.handle && handle < s.end; });
+        return it != services.end() ? it->gatts_if : ESP_GATT_IF_NONE;
+    }
+
+    auto find_link(uint16_t conn_id) -> Link* {
+        auto it = std::ranges::find(links, conn_id, &Link::conn_id);
+        return it != links.end() ? &*it : nullptr;
+    }
+} // namespace
+
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t*) {
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t) {
+    return ESP_OK;
+}
+
+esp_err_t esp_bluedroid_init() {
+    return ESP_OK;
+}
+
+esp_err_t esp_bluedroid_enable() {
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu) {
+    return mtu >= 23 && mtu <= 517 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_ble_gatts_register_callback(esp_gatts_cb_t callback) {
+    std::lock_guard lk(lock);
+    gatts_cb = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_app_register(uint16_t app_id) {
+    std::lock_guard lk(lock);
+    // gatts_if 从 3 开始分配，与 Bluedroid 一致
+    const auto gatts_if = static_cast<esp_gatt_if_t>(apps.size() + 3);
+    apps.push_back(gatts_if);
+    esp_ble_gatts_cb_param_t param{};
+    param.reg.status = ESP_GATT_OK;
+    param.reg.app_id = app_id;
+    push_gatts(ESP_GATTS_REG_EVT, gatts_if, param);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_create_service(esp_gatt_if_t gatts_if, esp_gatt_srvc_id_t* service_id, uint16_t num_handle) {
+    std::lock_guard lk(lock);
+    const uint16_t handle = next_handle;
+    next_handle += num_handle;
+    services.push_back({gatts_if, service_id->id.uuid.uuid.uuid16, handle, next_handle, static_cast<uint16_t>(handle + 1)});
+    esp_ble_gatts_cb_param_t param{};
+    param.create.status = ESP_GATT_OK;
+    param.create.service_handle = handle;
+    param.create.service_id = *service_id;
+    push_gatts(ESP_GATTS_CREATE_EVT, gatts_if, param);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_add_char(uint16_t service_handle, esp_bt_uuid_t* char_uuid, esp_gatt_perm_t, esp_gatt_char_prop_t, esp_attr_value_t*, esp_attr_control_t*) {
+    std::lock_guard lk(lock);
+    Service* service = find_service(service_handle);
+    if (!service || service->next + 2 > service->end) {
+        return ESP_ERR_NO_MEM;
+    }
+    // 特征声明占一个句柄，值句柄紧随其后，事件返回的是值句柄
+    const auto handle = static_cast<uint16_t>(service->next + 1);
+    service->next += 2;
+    attrs.push_back({service->gatts_if, service->uuid, service_handle, handle, char_uuid->uuid.uuid16, 0});
+    esp_ble_gatts_cb_param_t param{};
+    param.add_char.status = ESP_GATT_OK;
+    param.add_char.attr_handle = handle;
+    param.add_char.service_handle = service_handle;
+    param.add_char.char_uuid = *char_uuid;
+    push_gatts(ESP_GATTS_ADD_CHAR_EVT, service->gatts_if, param);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_add_char_descr(uint16_t service_handle, esp_bt_uuid_t* descr_uuid, esp_gatt_perm_t, esp_attr_value_t*, esp_attr_control_t*) {
+    std::lock_guard lk(lock);
+    Service* service = find_service(service_handle);
+    if (!service || service->next + 1 > service->end) {
+        return ESP_ERR_NO_MEM;
+    }
+    // 描述符属于服务里最后添加的特征
+    auto owner = std::ranges::find_if(attrs.rbegin(), attrs.rend(), [&](const sim::Attribute& a) { return a.service_handle == service_handle && a.char_handle == 0; });
+    const uint16_t handle = service->next++;
+    attrs.push_back({service->gatts_if, service->uuid, service_handle, handle, descr_uuid->uuid.uuid16, owner != attrs.rend() ? owner->handle : uint16_t(0)});
+    esp_ble_gatts_cb_param_t param{};
+    param.add_char_descr.status = ESP_GATT_OK;
+    param.add_char_descr.attr_handle = handle;
+    param.add_char_descr.service_handle = service_handle;
+    param.add_char_descr.descr_uuid = *descr_uuid;
+    push_gatts(ESP_GATTS_ADD_CHAR_DESCR_EVT, service->gatts_if, param);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_start_service(uint16_t service_handle) {
+    std::lock_guard lk(lock);
+    return find_service(service_handle) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle, uint16_t value_len, uint8_t* value, bool need_confirm) {
+    std::lock_guard lk(lock);
+    if (!find_link(conn_id)) {
+        return ESP_FAIL;
+    }
+    notifications.push_back({gatts_if, conn_id, attr_handle, need_confirm, std::vector<uint8_t>(value, value + value_len)});
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_send_response(esp_gatt_if_t gatts_if, uint16_t conn_id, uint32_t trans_id, esp_gatt_status_t status, esp_gatt_rsp_t* rsp) {
+    std::lock_guard lk(lock);
+    sim::Response r{gatts_if, conn_id, trans_id, status, {}};
+    if (rsp) {
+        r.value.assign(rsp->attr_value.value, rsp->attr_value.value + rsp->attr_value.len);
+    }
+    responses.push_back(std::move(r));
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback) {
+    std::lock_guard lk(lock);
+    gap_cb = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_config_adv_data(esp_ble_adv_data_t*) {
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t*) {
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_stop_advertising() {
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t* params) {
+    std::lock_guard lk(lock);
+    // 主机总是接受请求，按最大间隔生效
+    esp_ble_gap_cb_param_t param{};
+    param.update_conn_params.status = ESP_BT_STATUS_SUCCESS;
+    std::memcpy(param.update_conn_params.bda, params->bda, sizeof(esp_bd_addr_t));
+    param.update_conn_params.min_int = params->min_int;
+    param.update_conn_params.max_int = params->max_int;
+    param.update_conn_params.conn_int = params->max_int;
+    param.update_conn_params.latency = params->latency;
+    param.update_conn_params.timeout = params->timeout;
+    push_gap(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, param);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_pkt_data_len(esp_bd_addr_t, uint16_t tx_data_length) {
+    std::lock_guard lk(lock);
+    esp_ble_gap_cb_param_t param{};
+    param.pkt_data_length_cmpl.status = ESP_BT_STATUS_SUCCESS;
+    param.pkt_data_length_cmpl.params.tx_len = tx_data_length;
+    param.pkt_data_length_cmpl.params.rx_len = tx_data_length;
+    push_gap(ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT, param);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_preferred_phy(esp_bd_addr_t, esp_ble_gap_all_phys_t, esp_ble_gap_phy_mask_t, esp_ble_gap_phy_mask_t, esp_ble_gap_prefer_phy_options_t) {
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_rand_addr(esp_bd_addr_t) {
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_addr_create_static(esp_bd_addr_t rand_addr) {
+    const esp_bd_addr_t fixed = {0x11, 0x22, 0x33, 0x44, 0x55, 0xC6};
+    std::memcpy(rand_addr, fixed, sizeof(esp_bd_addr_t));
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_config_local_privacy(bool) {
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_device_name(const char*) {
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_security_param(esp_ble_sm_param_t, void*, uint8_t) {
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_security_rsp(esp_bd_addr_t, bool) {
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_set_encryption(esp_bd_addr_t, esp_ble_sec_act_t) {
+    return ESP_OK;
+}
+
+uint16_t esp_ble_get_cur_sendable_packets_num(uint16_t conn_id) {
+    std::lock_guard lk(lock);
+    return find_link(conn_id) ? sendable : 0;
+}
+
+namespace sim {
+    auto run() -> size_t {
+        size_t count = 0;
+        while (true) {
+            Event e;
+            esp_gatts_cb_t gatts;
+            esp_gap_ble_cb_t gap;
+            {
+                std::lock_guard lk(lock);
+                if (events.empty()) {
+                    return count;
+                }
+                e = std::move(events.front());
+                events.pop_front();
+                gatts = gatts_cb;
+                gap = gap_cb;
+            }
+            ++count;
+            if (e.gap) {
+                if (gap) {
+                    gap(e.gap_event, &e.gap_param);
+                }
+            } else if (gatts) {
+                if (e.gatts_event == ESP_GATTS_WRITE_EVT) {
+                    e.gatts_param.write.value = e.payload.data();
+                }
+                gatts(e.gatts_event, e.gatts_if, &e.gatts_param);
+            }
+        }
+    }
+
+    auto inject(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, const esp_ble_gatts_cb_param_t& param) -> void {
+        std::lock_guard lk(lock);
+        push_gatts(event, gatts_if, param);
+    }
+
+    auto inject(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t& param) -> void {
+        std::lock_guard lk(lock);
+        push_gap(event, param);
+    }
+
+    auto connect(uint16_t conn_id, const esp_bd_addr_t bda, uint16_t interval) -> void {
+        std::lock_guard lk(lock);
+        Link link{conn_id, {}};
+        std::memcpy(link.bda, bda, sizeof(esp_bd_addr_t));
+        links.push_back(link);
+        esp_ble_gatts_cb_param_t param{};
+        param.connect.conn_id = conn_id;
+        std::memcpy(param.connect.remote_bda, bda, sizeof(esp_bd_addr_t));
+        param.connect.conn_params.interval = interval;
+        param.connect.conn_params.latency = 0;
+        param.connect.conn_params.timeout = 400;
+        param.connect.ble_addr_type = BLE_ADDR_TYPE_RANDOM;
+        for (esp_gatt_if_t gatts_if : apps) {
+            push_gatts(ESP_GATTS_CONNECT_EVT, gatts_if, param);
+        }
+    }
+
+    auto disconnect(uint16_t conn_id) -> void {
+        std::lock_guard lk(lock);
+        Link* link = find_link(conn_id);
+        if (!link) {
+            return;
+        }
+        esp_ble_gatts_cb_param_t param{};
+        param.disconnect.conn_id = conn_id;
+        std::memcpy(param.disconnect.remote_bda, link->bda, sizeof(esp_bd_addr_t));
+        param.disconnect.reason = ESP_GATT_CONN_TERMINATE_PEER_USER;
+        std::erase_if(links, [conn_id](const Link& l) { return l.conn_id == conn_id; });
+        for (esp_gatt_if_t gatts_if : apps) {
+            push_gatts(ESP_GATTS_DISCONNECT_EVT, gatts_if, param);
+        }
+    }
+
+    auto write(uint16_t conn_id, uint16_t handle, std::span<const uint8_t> value, bool need_rsp) -> uint32_t {
+        std::lock_guard lk(lock);
+        const uint32_t trans_id = next_trans_id++;
+        esp_ble_gatts_cb_param_t param{};
+        param.write.conn_id = conn_id;
+        param.write.trans_id = trans_id;
+        if (const Link* link = find_link(conn_id)) {
+            std::memcpy(param.write.bda, link->bda, sizeof(esp_bd_addr_t));
+        }
+        param.write.handle = handle;
+        param.write.need_rsp = need_rsp;
+        param.write.len = static_cast<uint16_t>(value.size());
+        push_gatts(ESP_GATTS_WRITE_EVT, owner_of(handle), param, value);
+        return trans_id;
+    }
+
+    auto read(uint16_t conn_id, uint16_t handle, uint16_t offset) -> uint32_t {
+        std::lock_guard lk(lock);
+        const uint32_t trans_id = next_trans_id++;
+        esp_ble_gatts_cb_param_t param{};
+        param.read.conn_id = conn_id;
+        param.read.trans_id = trans_id;
+        if (const Link* link = find_link(conn_id)) {
+            std::memcpy(param.read.bda, link->bda, sizeof(esp_bd_addr_t));
+        }
+        param.read.handle = handle;
+        param.read.offset = offset;
+        param.read.is_long = offset != 0;
+        param.read.need_rsp = true;
+        push_gatts(ESP_GATTS_READ_EVT, owner_of(handle), param);
+        return trans_id;
+    }
+
+    auto congest(uint16_t conn_id, bool congested) -> void {
+        std::lock_guard lk(lock);
+        esp_ble_gatts_cb_param_t param{};
+        param.congest.conn_id = conn_id;
+        param.congest.congested = congested;
+        for (esp_gatt_if_t gatts_if : apps) {
+            push_gatts(ESP_GATTS_CONGEST_EVT, gatts_if, param);
+        }
+    }
+
+    auto set_sendable(uint16_t packets) -> void {
+        std::lock_guard lk(lock);
+        sendable = packets;
+    }
+
+    auto attributes() -> std::vector<Attribute> {
+        std::lock_guard lk(lock);
+        return attrs;
+    }
+
+    auto find_char(uint16_t uuid, size_t index) -> uint16_t {
+        std::lock_guard lk(lock);
+        for (const Attribute& a : attrs) {
+            if (a.char_handle == 0 && a.uuid == uuid && index-- == 0) {
+                return a.handle;
+            }
+        }
+        return 0;
+    }
+
+    auto find_descr(uint16_t char_handle, uint16_t uuid) -> uint16_t {
+        std::lock_guard lk(lock);
+        auto it = std::ranges::find_if(attrs, [&](const Attribute& a) { return a.char_handle == char_handle && a.uuid == uuid; });
+        return it != attrs.end() ? it->handle : 0;
+    }
+
+    auto take_notifications() -> std::vector<Notification> {
+        std::lock_guard lk(lock);
+        return std::exchange(notifications, {});
+    }
+
+    auto take_responses() -> std::vector<Response> {
+        std::lock_guard lk(lock);
+        return std::exchange(responses, {});
+    }
+
+    auto wait_notifications(size_t count, std::chrono::milliseconds timeout) -> std::vector<Notification> {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (true) {
+            run();
+            {
+                std::lock_guard lk(lock);
+                if (notifications.size() >= count || std::chrono::steady_clock::now() >= deadline) {
+                    return std::exchange(notifications, {});
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+} // namespace sim
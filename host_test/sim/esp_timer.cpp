@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ble_sim.hpp"
+#include "esp_timer.h"
+
+// 与 esp_timer 相同：全部回调在同一个分发线程上按到期顺序执行，回调执行时不持锁
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    int64_t alarm;  // 0 表示未启动
+    uint64_t period;
+};
+
+namespace {
+    std::mutex lock;
+    std::condition_variable wake;
+    std::vector<esp_timer*> timers;
+    std::thread dispatcher;
+    bool stopping = false;
+
+    auto dispatch() -> void {
+        std::unique_lock lk(lock);
+        while (!stopping) {
+            esp_timer* due = nullptr;
+            for (esp_timer* t : timers) {
+                if (t->alarm && (!due || t->alarm < due->alarm)) {
+                    due = t;
+                }
+            }
+            if (!due) {
+                wake.wait(lk);
+                continue;
+            }
+            const int64_t now = esp_timer_get_time();
+            if (due->alarm > now) {
+                wake.wait_for(lk, std::chrono::microseconds(due->alarm - now));
+                continue;
+            }
+            due->alarm = due->period ? now + static_cast<int64_t>(due->period) : 0;
+            const esp_timer_cb_t callback = due->callback;
+            void* arg = due->arg;
+            lk.unlock();
+            callback(arg);
+            lk.lock();
+        }
+    }
+
+    auto arm(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period) -> esp_err_t {
+        if (!timer) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        std::lock_guard lk(lock);
+        if (timer->alarm) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        timer->alarm = esp_timer_get_time() + static_cast<int64_t>(std::max<uint64_t>(timeout_us, 1));
+        timer->period = period;
+        wake.notify_one();
+        return ESP_OK;
+    }
+} // namespace
+
+int64_t esp_timer_get_time() {
+    // 设备上应用启动时 esp_timer 已走过一段，这里同样不从 0 开始，避免与代码里表示"未设置"的 0 混淆
+    static const auto epoch = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle) {
+    if (!create_args || !create_args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard lk(lock);
+    if (!dispatcher.joinable()) {
+        dispatcher = std::thread(dispatch);
+    }
+    auto* timer = new esp_timer{create_args->callback, create_args->arg, 0, 0};
+    timers.push_back(timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    return arm(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard lk(lock);
+    if (!timer->alarm) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->alarm = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard lk(lock);
+    if (timer->alarm) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    std::erase(timers, timer);
+    delete timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    std::lock_guard lk(lock);
+    return timer && timer->alarm;
+}
+
+namespace sim {
+    auto shutdown() -> void {
+        {
+            std::lock_guard lk(lock);
+            stopping = true;
+            wake.notify_one();
+        }
+        if (dispatcher.joinable()) {
+            dispatcher.join();
+        }
+    }
+} // namespace sim
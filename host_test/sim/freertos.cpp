@@ -0,0 +1,70 @@
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// 每个任务是一个分离的线程，任务通知用计数加条件变量实现；任务不会退出，控制块不回收
+struct tskTaskControlBlock {
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t count = 0;
+};
+
+namespace {
+    thread_local tskTaskControlBlock* current = nullptr;
+
+    auto self() -> tskTaskControlBlock* {
+        if (!current) {
+            current = new tskTaskControlBlock;
+        }
+        return current;
+    }
+} // namespace
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char*, uint32_t, void* pvParameters, UBaseType_t, TaskHandle_t* pxCreatedTask, BaseType_t) {
+    auto* task = new tskTaskControlBlock;
+    if (pxCreatedTask) {
+        *pxCreatedTask = task;
+    }
+    std::thread([task, pxTaskCode, pvParameters] {
+        current = task;
+        pxTaskCode(pvParameters);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+    {
+        std::lock_guard lk(xTaskToNotify->lock);
+        ++xTaskToNotify->count;
+    }
+    xTaskToNotify->notified.notify_one();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+    tskTaskControlBlock* task = self();
+    std::unique_lock lk(task->lock);
+    auto ready = [task] { return task->count != 0; };
+    if (xTicksToWait == portMAX_DELAY) {
+        task->notified.wait(lk, ready);
+    } else {
+        task->notified.wait_for(lk, std::chrono::milliseconds(xTicksToWait * portTICK_PERIOD_MS), ready);
+    }
+    const uint32_t count = task->count;
+    if (count) {
+        task->count = xClearCountOnExit ? 0 : count - 1;
+    }
+    return count;
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(xTicksToDelay * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount() {
+    static const auto start = std::chrono::steady_clock::now();
+    return static_cast<TickType_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / portTICK_PERIOD_MS);
+}
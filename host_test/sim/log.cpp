@@ -0,0 +1,54 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+namespace {
+    std::mutex lock;
+    esp_log_level_t level = ESP_LOG_WARN;
+} // namespace
+
+// 只支持 "*" 全局设置，测试默认只输出警告与错误
+void esp_log_level_set(const char*, esp_log_level_t _level) {
+    std::lock_guard lk(lock);
+    level = _level;
+}
+
+void esp_log_write(esp_log_level_t _level, const char* tag, const char* format, ...) {
+    std::lock_guard lk(lock);
+    if (_level > level) {
+        return;
+    }
+    static constexpr char letters[] = "NEWIDV";
+    std::printf("%c (%lld) %s: ", letters[_level], static_cast<long long>(esp_timer_get_time() / 1000), tag);
+    va_list args;
+    va_start(args, format);
+    std::vprintf(format, args);
+    va_end(args);
+    std::printf("\n");
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:
+            return "ESP_OK";
+        case ESP_FAIL:
+            return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:
+            return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:
+            return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:
+            return "ESP_ERR_INVALID_STATE";
+        default:
+            return "UNKNOWN ERROR";
+    }
+}
+
+void _esp_error_check_failed(esp_err_t rc, const char* file, int line, const char* function, const char* expression) {
+    std::fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\nfunc: %s\nexpression: %s\n", rc, esp_err_to_name(rc), file, line, function, expression);
+    std::abort();
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// 配置模块的占位，主机测试不读配置文件
+template<typename... Args>
+class TEvent {
+public:
+    void operator()(Args...) {
+    }
+};
+
+namespace config {
+    inline auto setup_update(TEvent<>*) -> void {
+    }
+} // namespace config
@@ -0,0 +1,5 @@
+#pragma once
+#include "esp_bt_defs.h"
+
+esp_err_t esp_bluedroid_init();
+esp_err_t esp_bluedroid_enable();
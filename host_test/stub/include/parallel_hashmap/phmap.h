@@ -0,0 +1,18 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+
+// 只实现 util::Map 用到的部分；主机测试里这些表只在初始化时写入，不需要分段加锁
+namespace phmap {
+    namespace priv {
+        template<typename K>
+        using hash_default_hash = std::hash<K>;
+        template<typename K>
+        using hash_default_eq = std::equal_to<K>;
+    } // namespace priv
+
+    template<typename K, typename V, typename Hash, typename Eq, typename Alloc, size_t N, typename Mutex>
+    using parallel_flat_hash_map = std::unordered_map<K, V, Hash, Eq>;
+} // namespace phmap
@@ -0,0 +1,25 @@
+#pragma once
+// 主机构建用的配置，取 sdkconfig 与 main/Kconfig.projbuild 的默认值
+
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_BT_ACL_CONNECTIONS 4
+#define CONFIG_BT_GATT_MAX_SR_PROFILES 8
+
+#define CONFIG_BLE_CONN_ACTIVE_INTERVAL_MIN 6
+#define CONFIG_BLE_CONN_ACTIVE_INTERVAL_MAX 6
+#define CONFIG_BLE_CONN_IDLE_INTERVAL_MIN 24
+#define CONFIG_BLE_CONN_IDLE_INTERVAL_MAX 40
+#define CONFIG_BLE_CONN_IDLE_LATENCY 4
+#define CONFIG_BLE_CONN_SUPERVISION_TIMEOUT 400
+#define CONFIG_BLE_CONN_IDLE_TIMEOUT_MS 2000
+#define CONFIG_BLE_NOTIFY_QUEUE_LENGTH 16
+#define CONFIG_BLE_TELEMETRY_DEFER_MS 50
+#define CONFIG_BLE_TELEMETRY_MAX_DEFER_MS 1000
+
+#define CONFIG_HID_MOUSE_AXIS_8BIT 1
+
+#define CONFIG_INPUT_TASK_CORE 0
+#define CONFIG_INPUT_TASK_PRIORITY 10
+#define CONFIG_INPUT_QUEUE_LENGTH 256
+#define CONFIG_INPUT_SCHEDULE_LENGTH 64
+#define CONFIG_INPUT_LATE_THRESHOLD_US 500
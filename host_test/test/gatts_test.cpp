@@ -0,0 +1,244 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include "Battery/Battery.hpp"
+#include "Event/Event.hpp"
+#include "HID/HID.hpp"
+#include "ble_sim.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+    int failures = 0;
+
+#define CHECK(cond)                                                                                                                                                                                    \
+    do {                                                                                                                                                                                               \
+        if (!(cond)) {                                                                                                                                                                                 \
+            std::printf("%s:%d: CHECK(%s) 失败\n", __FILE__, __LINE__, #cond);                                                                                                                       \
+            ++failures;                                                                                                                                                                                \
+        }                                                                                                                                                                                              \
+    } while (0)
+
+    constexpr esp_bd_addr_t host_a = {0xA0, 0x01, 0x02, 0x03, 0x04, 0x05};
+    constexpr esp_bd_addr_t host_b = {0xB0, 0x01, 0x02, 0x03, 0x04, 0x05};
+
+    constexpr uint16_t event_click_uuid = 0xEF01;
+    constexpr uint16_t event_move_uuid = 0xEF02;
+
+    /// 创建功能并跑完 REG/CREATE/ADD_CHAR/ADD_CHAR_DESCR
+    auto start() -> void {
+        FeatureBase::initialize();
+        BLEBase::initialize();
+        sim::run();
+    }
+
+    auto battery_handle() -> uint16_t {
+        return sim::find_char(ESP_GATT_UUID_BATTERY_LEVEL);
+    }
+
+    /// HID 报告特征按键盘、鼠标、绝对坐标的顺序注册
+    auto mouse_handle() -> uint16_t {
+        return sim::find_char(ESP_GATT_UUID_HID_REPORT, 1);
+    }
+
+    auto subscribe(uint16_t conn_id, uint16_t char_handle) -> void {
+        const uint8_t enable[] = {0x01, 0x00};
+        sim::write(conn_id, sim::find_descr(char_handle, ESP_GATT_UUID_CHAR_CLIENT_CONFIG), enable);
+        sim::run();
+        const auto responses = sim::take_responses();
+        CHECK(responses.size() == 1 && responses[0].status == ESP_GATT_OK);
+    }
+
+    auto count_for(const std::vector<sim::Notification>& notes, uint16_t conn_id, uint16_t handle) -> size_t {
+        return std::ranges::count_if(notes, [&](const sim::Notification& n) { return n.conn_id == conn_id && n.handle == handle; });
+    }
+
+    auto write_move(uint16_t conn_id, int32_t x, int32_t y) -> esp_gatt_status_t {
+        uint8_t value[8];
+        std::memcpy(value, &x, sizeof(x));
+        std::memcpy(value + 4, &y, sizeof(y));
+        sim::write(conn_id, sim::find_char(event_move_uuid), value);
+        sim::run();
+        const auto responses = sim::take_responses();
+        return responses.size() == 1 ? responses[0].status : ESP_GATT_ERROR;
+    }
+
+    /// 每个特征都拿到了句柄，可通知的特征都有 CCCD，同 UUID 的 HID 报告各自绑定到不同句柄
+    auto test_register() -> void {
+        start();
+        CHECK(battery_handle() != 0);
+        CHECK(sim::find_descr(battery_handle(), ESP_GATT_UUID_CHAR_CLIENT_CONFIG) != 0);
+        CHECK(sim::find_char(event_click_uuid) != 0);
+
+        uint16_t reports[3];
+        for (size_t i = 0; i < 3; ++i) {
+            reports[i] = sim::find_char(ESP_GATT_UUID_HID_REPORT, i);
+            CHECK(reports[i] != 0);
+            CHECK(sim::find_descr(reports[i], ESP_GATT_UUID_CHAR_CLIENT_CONFIG) != 0);
+            CHECK(sim::find_descr(reports[i], ESP_GATT_UUID_RPT_REF_DESCR) != 0);
+        }
+        CHECK(reports[0] != reports[1] && reports[1] != reports[2]);
+
+        // 报告参考描述符的第一个字节是报告 ID：键盘 1、鼠标 2、绝对坐标 3
+        sim::connect(0, host_a);
+        for (size_t i = 0; i < 3; ++i) {
+            sim::read(0, sim::find_descr(reports[i], ESP_GATT_UUID_RPT_REF_DESCR));
+        }
+        sim::run();
+        const auto responses = sim::take_responses();
+        CHECK(responses.size() == 3);
+        for (size_t i = 0; i < responses.size(); ++i) {
+            CHECK(!responses[i].value.empty() && responses[i].value[0] == i + 1);
+        }
+    }
+
+    /// 超过 MTU 的特征按偏移分段读出
+    auto test_read() -> void {
+        start();
+        sim::connect(0, host_a);
+        const uint16_t map = sim::find_char(ESP_GATT_UUID_HID_REPORT_MAP);
+        sim::read(0, map);
+        sim::read(0, map, 22);
+        sim::read(0, battery_handle());
+        sim::run();
+        const auto responses = sim::take_responses();
+        CHECK(responses.size() == 3);
+        if (responses.size() != 3) {
+            return;
+        }
+        // 默认 MTU 23，每段最多 22 字节
+        CHECK(responses[0].value.size() == 22);
+        CHECK(std::equal(responses[0].value.begin(), responses[0].value.end(), HID::report_descriptor.begin()));
+        CHECK(std::equal(responses[1].value.begin(), responses[1].value.end(), HID::report_descriptor.begin() + 22));
+        CHECK(responses[2].status == ESP_GATT_OK && responses[2].value == std::vector<uint8_t>{100});
+    }
+
+    /// 电量只发给打开了 CCCD 的连接，值不变时不重复发
+    auto test_notify() -> void {
+        start();
+        sim::connect(0, host_a);
+        sim::run();
+
+        Battery::instance()->notify();
+        CHECK(sim::wait_notifications(1, 100ms).empty());
+
+        subscribe(0, battery_handle());
+        Battery::instance()->notify();
+        auto notes = sim::wait_notifications(1, 2s);
+        CHECK(notes.size() == 1);
+        if (notes.size() == 1) {
+            CHECK(notes[0].handle == battery_handle() && notes[0].conn_id == 0);
+            CHECK(notes[0].value == std::vector<uint8_t>{100});
+        }
+
+        Battery::instance()->notify();
+        CHECK(sim::wait_notifications(1, 200ms).empty());
+
+        Battery::instance()->set_value(80);
+        Battery::instance()->notify();
+        notes = sim::wait_notifications(1, 2s);
+        CHECK(notes.size() == 1 && notes[0].value == std::vector<uint8_t>{80});
+    }
+
+    /// 写入 Event 的移动特征，经输入任务合成为 HID 鼠标报告发给订阅的连接
+    auto test_write() -> void {
+        start();
+        sim::connect(0, host_a);
+        sim::run();
+        subscribe(0, mouse_handle());
+
+        CHECK(write_move(0, 5, -3) == ESP_GATT_OK);
+        const auto notes = sim::wait_notifications(1, 1s);
+        CHECK(count_for(notes, 0, mouse_handle()) == 1);
+        if (!notes.empty()) {
+            // 按键、X、Y、滚轮各 1 字节
+            CHECK(notes[0].value == (std::vector<uint8_t>{0, 5, static_cast<uint8_t>(-3), 0}));
+        }
+    }
+
+    /// 多条连接各自订阅；断开后槽位被新连接占用时，不沿用上一条连接的订阅
+    auto test_connections() -> void {
+        start();
+        sim::connect(0, host_a);
+        sim::connect(1, host_b);
+        sim::run();
+        subscribe(0, battery_handle());
+        subscribe(1, battery_handle());
+
+        Battery::instance()->set_value(90);
+        Battery::instance()->notify();
+        auto notes = sim::wait_notifications(2, 2s);
+        CHECK(count_for(notes, 0, battery_handle()) == 1);
+        CHECK(count_for(notes, 1, battery_handle()) == 1);
+
+        sim::disconnect(0);
+        sim::run();
+        CHECK(BLEBase::get_connections().size() == 1);
+        Battery::instance()->set_value(70);
+        Battery::instance()->notify();
+        notes = sim::wait_notifications(2, 300ms);
+        CHECK(notes.size() == 1 && count_for(notes, 1, battery_handle()) == 1);
+
+        sim::connect(2, host_a);
+        sim::run();
+        CHECK(BLEBase::get_connections().size() == 2);
+        Battery::instance()->set_value(60);
+        Battery::instance()->notify();
+        notes = sim::wait_notifications(2, 300ms);
+        CHECK(notes.size() == 1 && count_for(notes, 1, battery_handle()) == 1);
+    }
+
+    /// 控制器没有空闲缓冲时报告留在队列里，缓冲恢复后由重试定时器发出
+    auto test_backpressure() -> void {
+        start();
+        sim::connect(0, host_a);
+        sim::run();
+        subscribe(0, mouse_handle());
+
+        sim::set_sendable(0);
+        CHECK(write_move(0, 1, 0) == ESP_GATT_OK);
+        CHECK(sim::wait_notifications(1, 50ms).empty());
+        CHECK(BLEBase::get_notify_stats().stalls >= 1);
+
+        sim::set_sendable(8);
+        const auto notes = sim::wait_notifications(1, 1s);
+        CHECK(count_for(notes, 0, mouse_handle()) >= 1);
+        if (!notes.empty()) {
+            CHECK(notes[0].value[1] == 1);
+        }
+    }
+
+    struct Case {
+        std::string_view name;
+        std::function<void()> run;
+    };
+
+    const Case cases[] = {
+            {"register", test_register},
+            {"read", test_read},
+            {"notify", test_notify},
+            {"write", test_write},
+            {"connections", test_connections},
+            {"backpressure", test_backpressure},
+    };
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::printf("用法: %s <用例>\n", argv[0]);
+        return 2;
+    }
+    auto it = std::ranges::find(cases, std::string_view(argv[1]), &Case::name);
+    if (it == std::end(cases)) {
+        std::printf("未知用例 %s\n", argv[1]);
+        return 2;
+    }
+    it->run();
+    sim::shutdown();
+    std::printf("%s: %s\n", argv[1], failures ? "失败" : "通过");
+    std::fflush(stdout);
+    // 输入任务线程还在阻塞等待，跳过静态析构直接退出
+    std::_Exit(failures ? 1 : 0);
+}
@@ -1,4 +1,8 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
 #include <format>
 #include <fstream>
 #include <functional>
@@ -11,17 +15,20 @@
 #include <vector>
 #include "../config/Config.h"
 #include "../config/Field.h"
+#include "../lockfree_queue.hpp"
 #include "../util.hpp"
 
 #include <esp_gatt_common_api.h>
-#include <esp_gattc_api.h>
-#include <rwlock.hpp>
+#include <seqlock.hpp>
 #include "esp_bt.h"
 #include "esp_bt_defs.h"
 #include "esp_bt_main.h"
 #include "esp_gap_ble_api.h"
 #include "esp_gatts_api.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+
+class DispatchBench;
 
 class BLEBase {
 public:
@@ -38,6 +45,23 @@ public:
         adv_params.peer_addr_type = BLE_ADDR_TYPE_PUBLIC;
         adv_params.adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
 
+        const esp_timer_create_args_t idle_args{
+                .callback = idle_check,
+                .arg = nullptr,
+                .dispatch_method = ESP_TIMER_TASK,
+                .name = "ble_idle",
+                .skip_unhandled_events = true,
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&idle_args, &idle_timer));
+        const esp_timer_create_args_t retry_args{
+                .callback = retry_notify,
+                .arg = nullptr,
+                .dispatch_method = ESP_TIMER_TASK,
+                .name = "ble_notify",
+                .skip_unhandled_events = true,
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&retry_args, &retry_timer));
+
         init_ble();
         init_ble_security();
     }
@@ -46,6 +70,157 @@ public:
         return "FeatureBase";
     }
 
+    static constexpr size_t max_connections = CONFIG_BT_ACL_CONNECTIONS;
+    static constexpr size_t max_subscriptions = 8;
+    // send() 的目标，表示发给全部连接
+    static constexpr uint16_t all_connections = 0xFFFF;
+    // 可进入发送队列的最大通知长度，更长的通知在链路空闲时直接发送
+    static constexpr uint16_t max_queued_payload = 64;
+
+    /// 最快一条连接的连接间隔(µs)，报告按它定节拍，未连接时为 0
+    static auto get_conn_interval_us() -> uint32_t {
+        return conn_interval * 1250;
+    }
+
+    struct ConnStats {
+        uint16_t interval;  // 1.25 ms，最快一条连接
+        uint16_t latency;
+        uint16_t timeout;  // 10 ms
+        uint8_t connections;
+        bool active;  // 有连接当前请求的是低延迟参数
+        uint32_t requests;
+        uint32_t accepted;
+        uint32_t rejected;  // 请求失败，或主机给出的参数不满足请求
+        uint32_t peer_updates;  // 主机主动发起的参数更新
+    };
+
+    static auto get_conn_stats() -> ConnStats {
+        return {
+                conn_interval.load(std::memory_order_relaxed),
+                conn_latency.load(std::memory_order_relaxed),
+                conn_timeout.load(std::memory_order_relaxed),
+                open_connections.load(std::memory_order_relaxed),
+                std::ranges::any_of(conn_control, [](const ConnControl& c) { return c.open.load(std::memory_order_relaxed) && c.active.load(std::memory_order_relaxed); }),
+                conn_requests.load(std::memory_order_relaxed),
+                conn_accepted.load(std::memory_order_relaxed),
+                conn_rejected.load(std::memory_order_relaxed),
+                conn_peer_updates.load(std::memory_order_relaxed),
+        };
+    }
+
+    struct NotifyStats {
+        uint32_t sent;
+        uint32_t deferred;  // 进队时链路拥塞或已有积压，需要排队等待的通知数
+        uint32_t dropped;  // 队列满或超长且链路忙被丢弃
+        uint32_t stalls;  // 因拥塞或控制器缓冲耗尽而暂停发送的次数
+        uint32_t congest_events;
+        uint32_t held;  // HID 活跃期间被推迟的低优先级通知
+        uint32_t merged;  // 发出前被同一特征的新值覆盖的低优先级通知
+        uint32_t unsubscribed;  // 对端没有打开 CCCD 而跳过的通知
+        uint32_t unchanged;  // 与上次发给同一连接的值相同而跳过的通知
+        uint32_t depth;  // 全部连接的当前积压
+        uint32_t max_queue_us;
+        uint32_t avg_queue_us;
+    };
+
+    static auto get_notify_stats() -> NotifyStats {
+        uint32_t depth = 0;
+        for (const auto& ctl : conn_control) {
+            for (const auto& lane : ctl.lanes) {
+                depth += lane.size();
+            }
+        }
+        const uint32_t sent = notify_sent.load(std::memory_order_relaxed);
+        return {
+                sent,
+                notify_deferred.load(std::memory_order_relaxed),
+                notify_dropped.load(std::memory_order_relaxed),
+                notify_stalls.load(std::memory_order_relaxed),
+                notify_congest.load(std::memory_order_relaxed),
+                notify_held.load(std::memory_order_relaxed),
+                notify_merged.load(std::memory_order_relaxed),
+                notify_unsubscribed.load(std::memory_order_relaxed),
+                notify_unchanged.load(std::memory_order_relaxed),
+                depth,
+                notify_max_queue_us.load(std::memory_order_relaxed),
+                sent ? static_cast<uint32_t>(notify_queue_us.load(std::memory_order_relaxed) / sent) : 0,
+        };
+    }
+
+    struct Subscription {
+        uint16_t char_handle;  // 0 表示空位
+        uint16_t value;  // CCCD 值，bit0 通知，bit1 指示
+
+        auto operator==(const Subscription&) const -> bool = default;
+    };
+
+    /// 单条连接的状态
+    struct ConnectionInfo {
+        uint16_t conn_id;
+        esp_bd_addr_t bda;
+        uint16_t mtu;
+        uint16_t tx_octets;  // DLE 协商后单个链路层包的最大载荷
+        uint16_t rx_octets;
+        uint8_t tx_phy;  // 1: 1M 2: 2M 3: Coded
+        uint8_t rx_phy;
+        uint16_t interval;  // 1.25 ms
+        uint16_t latency;
+        uint16_t timeout;  // 10 ms
+        bool encrypted;
+        std::array<Subscription, max_subscriptions> subscriptions;
+    };
+
+    /// 全部连接的状态快照，任意线程可调用
+    static auto get_connections() -> std::vector<ConnectionInfo> {
+        std::array<Connection, max_connections> snapshot;
+        connections_lock.read([&] { snapshot = connections; });
+        std::vector<ConnectionInfo> out;
+        for (const auto& conn : snapshot) {
+            if (conn.used) {
+                out.push_back(conn.info);
+            }
+        }
+        return out;
+    }
+
+    /**
+     * @brief 把有改动的订阅记录写入文件，由主循环周期调用，不能在 BTC 任务中调用
+     *
+     * 主机配置 HID 时会连续写多个 CCCD，最后一次改动后静默 cccd_save_delay_us 才写，整批只写一次闪存。
+     */
+    static auto save_subscriptions() -> void {
+        if (!remembered_dirty.load(std::memory_order_acquire) || esp_timer_get_time() - remembered_changed_at.load(std::memory_order_relaxed) < cccd_save_delay_us) {
+            return;
+        }
+        // 先清标记再取快照，写文件期间的新改动会在下一轮再写
+        remembered_dirty.store(false, std::memory_order_relaxed);
+        std::array<Remembered, max_remembered> snapshot;
+        remembered_lock.read([&] { snapshot = remembered; });
+
+        std::ofstream out("/FATFS/cccd.bin", std::ios::binary);
+        if (out.is_open()) {
+            out.write(reinterpret_cast<const char*>(snapshot.data()), sizeof(snapshot));
+        } else {
+            ESP_LOGE("BLE CONN", "写订阅文件失败");
+            remembered_dirty.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief 输入活动通知，任意线程可调用
+     *
+     * 空闲参数下的连接立即请求低延迟连接参数；超过 CONFIG_BLE_CONN_IDLE_TIMEOUT_MS 没有活动后由空闲检查放宽。
+     */
+    static auto note_activity() -> void {
+        last_activity.store(esp_timer_get_time(), std::memory_order_relaxed);
+        for (size_t slot = 0; slot < max_connections; ++slot) {
+            const ConnControl& ctl = conn_control[slot];
+            if (ctl.open.load(std::memory_order_relaxed) && !ctl.active.load(std::memory_order_relaxed)) {
+                request_conn_params(slot, true);
+            }
+        }
+    }
+
     static std::string get_address() {
         return std::format("{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}", addr[0], addr[1], addr[2], addr[3], addr[4], addr[5]);
     }
@@ -59,32 +234,79 @@ protected:
     ~BLEBase() = default;
     BLEBase() = default;
 
-    struct DESCR_Profile {
-        uint16_t descr_handle;
-        esp_bt_uuid_t descr_uuid;
+    /**
+     * @brief 特征读写回调：对象指针 + 编译期生成的跳板函数
+     *
+     * 不做堆分配也不做类型擦除，调用即一次间接跳转。由 BLE_MSG(func) 生成。
+     */
+    struct RW_Callback {
+        using Thunk = esp_gatt_status_t (*)(void*, esp_gatts_cb_event_t);
+
+        constexpr RW_Callback() = default;
+        constexpr RW_Callback(std::nullptr_t) {
+        }
+
+        template<auto Method, typename T>
+        static constexpr auto bind(T* _obj) -> RW_Callback {
+            return RW_Callback(_obj, [](void* obj, esp_gatts_cb_event_t event) -> esp_gatt_status_t { return (static_cast<T*>(obj)->*Method)(event); });
+        }
+
+        constexpr explicit operator bool() const {
+            return thunk_ != nullptr;
+        }
+
+        auto operator()(esp_gatts_cb_event_t event) const -> esp_gatt_status_t {
+            return thunk_(obj_, event);
+        }
+
+    private:
+        constexpr RW_Callback(void* obj, Thunk thunk) : obj_(obj), thunk_(thunk) {
+        }
+
+        void* obj_ = nullptr;
+        Thunk thunk_ = nullptr;
+    };
+
+    struct ATTR_Profile {
         esp_gatt_perm_t perm;
         esp_attr_value_t attr_value;
-        RWLock lock;
-        std::function<esp_gatt_status_t(esp_gatts_cb_event_t)> rw_cb;
+        SeqLock lock;
+        RW_Callback rw_cb;
+        uint16_t cccd_of = 0;  // 非 0 时本属性是 CCCD，值为它所配置的特征句柄
     };
 
-    struct CHAR_Profile {
+    struct DESCR_Profile : ATTR_Profile {
+        uint16_t descr_handle;
+        esp_bt_uuid_t descr_uuid;
+    };
+
+    /// 通知的优先级，数值越小越先发
+    enum class Priority : uint8_t {
+        INPUT = 0,  // HID 输入报告
+        ACK = 1,  // 对主机请求的应答
+        TELEMETRY = 2,  // 电量、统计等周期数据，HID 活跃时推迟，同一特征只保留最新值
+    };
+    static constexpr size_t priority_count = 3;
+
+    struct CHAR_Profile : ATTR_Profile {
         uint16_t char_handle;
         esp_bt_uuid_t char_uuid;
-        esp_gatt_perm_t perm;
         esp_gatt_char_prop_t property;
-        esp_attr_value_t attr_value;
-        RWLock lock;
+        Priority priority = Priority::ACK;
+        // 为 true 时与上次发给同一连接的值相同就不再发送，适合电量这类状态值
+        bool skip_unchanged = false;
+        // 每个连接槽上次发送的值：高 32 位为连接代数，低 32 位为内容哈希
+        std::array<std::atomic<uint64_t>, max_connections> last_sent;
+        // 不小于 0 时，通知真正交给协议栈的那一刻把 esp_timer 时刻(int64)写到载荷的这个偏移处，排队时间不计入
+        int16_t stamp_offset = -1;
 
         std::vector<std::shared_ptr<DESCR_Profile>> descrs;
-        std::function<esp_gatt_status_t(esp_gatts_cb_event_t)> rw_cb;
     };
 
     struct GATTS_Profile {
         std::string name;
         esp_gatt_if_t gatts_if;
         uint16_t app_id;
-        uint16_t conn_id;
         uint16_t service_handle;
         esp_gatt_srvc_id_t service_id;
         uint16_t num_handle;
@@ -94,6 +316,10 @@ protected:
     };
 
     static auto add_feature(const std::string& _name, const std::shared_ptr<BLEBase>& _that, uint16_t uuid) -> std::shared_ptr<GATTS_Profile> {
+        if (apps.size() >= CONFIG_BT_GATT_MAX_SR_PROFILES) {
+            ESP_LOGE("BLE", "%s 超出 CONFIG_BT_GATT_MAX_SR_PROFILES(%d)", _name.data(), CONFIG_BT_GATT_MAX_SR_PROFILES);
+        }
+
         auto app = std::make_shared<GATTS_Profile>();
         auto hash = std::hash<std::string>();
         apps.push_back(app);
@@ -114,7 +340,7 @@ protected:
     template<typename T>
     static std::shared_ptr<CHAR_Profile> register_char(std::shared_ptr<GATTS_Profile> _profile,
                                                        T& buffer,
-                                                       const std::function<esp_gatt_status_t(esp_gatts_cb_event_t)> _handler = nullptr,
+                                                       RW_Callback _handler = nullptr,
                                                        uint16_t uuid_char = 0,
                                                        esp_gatt_perm_t perm = ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
                                                        esp_gatt_char_prop_t property = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE) {
@@ -126,7 +352,7 @@ protected:
 
         char_->perm = perm;
         char_->property = property;
-        char_->rw_cb = std::move(_handler);
+        char_->rw_cb = _handler;
         char_->attr_value.attr_max_len = sizeof(T);
         char_->attr_value.attr_len = sizeof(T);
         char_->attr_value.attr_value = (uint8_t*)&buffer;
@@ -139,7 +365,7 @@ protected:
     static std::shared_ptr<DESCR_Profile> register_descr(std::shared_ptr<GATTS_Profile> gatts_profile,
                                                          std::shared_ptr<CHAR_Profile> _profile,
                                                          T& buffer,
-                                                         const std::function<esp_gatt_status_t(esp_gatts_cb_event_t)> _handler = nullptr,
+                                                         RW_Callback _handler = nullptr,
                                                          uint16_t uuid_char = 0,
                                                          esp_gatt_perm_t perm = ESP_GATT_PERM_READ) {
         auto descr = std::make_shared<DESCR_Profile>();
@@ -148,7 +374,7 @@ protected:
 
         auto hash = std::hash<time_t>();
         descr->perm = perm;
-        descr->rw_cb = std::move(_handler);
+        descr->rw_cb = _handler;
         descr->attr_value.attr_max_len = sizeof(T);
         descr->attr_value.attr_len = sizeof(T);
         descr->attr_value.attr_value = (uint8_t*)&buffer;
@@ -158,9 +384,134 @@ protected:
         return descr;
     }
 
-    bool send(std::shared_ptr<GATTS_Profile> gatts_profile, std::shared_ptr<CHAR_Profile> char_, bool need_confirm = false) {
-        esp_err_t err = esp_ble_gatts_send_indicate(gatts_profile->gatts_if, gatts_profile->conn_id, char_->char_handle, char_->attr_value.attr_len, char_->attr_value.attr_value, need_confirm);
-        return err == ESP_OK;
+    /**
+     * @brief 发送通知/指示
+     *
+     * 通知按特征的 Priority 进入目标连接的有界队列再按链路状态发出：拥塞或控制器没有空闲缓冲时暂停，解除后继续，
+     * 队列满时丢弃新通知并计数。每次总是先发优先级高的队列。
+     * @param conn_id 目标连接，all_connections 时发给全部连接
+     * @return 至少一条连接已发出或已排队
+     */
+    bool send(std::shared_ptr<GATTS_Profile> gatts_profile, std::shared_ptr<CHAR_Profile> char_, uint16_t conn_id = all_connections, bool need_confirm = false) {
+        std::array<uint8_t, ESP_GATT_MAX_ATTR_LEN> value;
+        uint16_t len = 0;
+        char_->lock.read([&] {
+            len = std::min<uint16_t>(char_->attr_value.attr_len, value.size());
+            std::memcpy(value.data(), char_->attr_value.attr_value, len);
+        });
+
+        Outbound out;
+        out.gatts_if = gatts_profile->gatts_if;
+        out.need_confirm = need_confirm;
+        out.priority = char_->priority;
+        out.handle = char_->char_handle;
+        out.len = len;
+        out.stamp_offset = char_->stamp_offset;
+        out.queued_at = esp_timer_get_time();
+        const bool oversize = len > max_queued_payload;
+        if (!oversize) {
+            std::memcpy(out.value, value.data(), len);
+        }
+
+        bool sent = false;
+        for (size_t slot = 0; slot < max_connections; ++slot) {
+            if (!conn_control[slot].open.load(std::memory_order_acquire)) {
+                continue;
+            }
+            uint16_t id = 0;
+            bool on = false;
+            connections_lock.read([&] {
+                id = connections[slot].info.conn_id;
+                on = subscription_value(connections[slot].info, out.handle) & (need_confirm ? 0x02 : 0x01);
+            });
+            if (conn_id != all_connections && id != conn_id) {
+                continue;
+            }
+            if (!on) {
+                notify_unsubscribed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            out.generation = conn_control[slot].generation.load(std::memory_order_acquire);
+            const uint64_t stamp = static_cast<uint64_t>(out.generation) << 32 | fnv1a(value.data(), len);
+            if (char_->skip_unchanged && char_->last_sent[slot].exchange(stamp, std::memory_order_relaxed) == stamp) {
+                notify_unchanged.fetch_add(1, std::memory_order_relaxed);
+                sent = true;
+                continue;
+            }
+            if (oversize ? send_direct(slot, id, out, value.data()) : enqueue(slot, out)) {
+                sent = true;
+            } else {
+                // 没发出去的值不能作为下次比较的基准
+                char_->last_sent[slot].store(0, std::memory_order_relaxed);
+            }
+        }
+        return sent;
+    }
+
+    /// 当前正在分发的读写事件来自哪条连接，仅在 BTC 任务的读写回调中有效
+    static auto caller_conn_id() -> uint16_t {
+        return current_conn_id;
+    }
+
+    struct CallerSlot {
+        size_t slot;
+        uint32_t generation;  // 槽位被新连接占用时变化，据此丢弃上一条连接留下的状态
+    };
+
+    /// 当前读写事件来自的连接槽位，连接不在表中时返回 nullopt；仅在 BTC 任务的读写回调中有效
+    static auto caller_slot() -> std::optional<CallerSlot> {
+        const Connection* conn = find_connection(current_conn_id);
+        if (!conn) {
+            return std::nullopt;
+        }
+        const size_t slot = slot_of(conn);
+        return CallerSlot{slot, conn_control[slot].generation.load(std::memory_order_relaxed)};
+    }
+
+    /// 连接是否打开了该特征的通知(confirm 为 true 时看指示)
+    static auto subscribed(const std::shared_ptr<CHAR_Profile>& char_, uint16_t conn_id, bool confirm = false) -> bool {
+        bool on = false;
+        connections_lock.read([&] {
+            const Connection* conn = find_connection(conn_id);
+            on = conn && subscription_value(conn->info, char_->char_handle) & (confirm ? 0x02 : 0x01);
+        });
+        return on;
+    }
+
+    /**
+     * @brief 订阅了任一给定特征的连接是否全部处于拥塞或仍有积压
+     *
+     * 只要还有一条订阅的连接能发，就返回 false，不让一条慢链路拖住其它主机；没有订阅的连接时也返回 false。
+     */
+    static auto backlogged(std::initializer_list<uint16_t> _char_handles) -> bool {
+        bool any = false;
+        for (size_t slot = 0; slot < max_connections; ++slot) {
+            const ConnControl& ctl = conn_control[slot];
+            if (!ctl.open.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            bool subscribed = false;
+            connections_lock.read([&] {
+                subscribed = std::ranges::any_of(_char_handles, [&](uint16_t handle) { return subscription_value(connections[slot].info, handle) & 0x01; });
+            });
+            if (!subscribed) {
+                continue;
+            }
+            if (!ctl.congested.load(std::memory_order_relaxed) && !ctl.stalled.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            any = true;
+        }
+        return any;
+    }
+
+    /// 在写锁内修改特征绑定的缓冲区，保证 READ 与通知不会读到半份数据
+    template<typename T, typename F>
+    static auto update(const std::shared_ptr<T>& attr, F&& _modify) -> void
+        requires(std::is_base_of_v<ATTR_Profile, T>)
+    {
+        SeqLock::WriteGuard wlk(attr->lock);
+        _modify();
     }
 
     virtual bool gatts_event_callback(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param) {
@@ -173,83 +524,682 @@ protected:
     inline static std::vector<std::shared_ptr<GATTS_Profile>> apps;
 
 private:
+    friend class DispatchBench;
+
     inline static util::Map<esp_gatts_cb_event_t, std::function<void(esp_gatts_cb_event_t, esp_gatt_if_t, esp_ble_gatts_cb_param_t*)>> gatts_event;
     inline static util::Map<esp_gap_ble_cb_event_t, std::function<void(esp_gap_ble_cb_event_t, esp_ble_gap_cb_param_t*)>> gap_event;
+    // gatts_if -> 应用 路由表，REG 时填入，feature 为预先解析好的 gatts_event_callback 接收者
+    struct GATTS_Route {
+        GATTS_Profile* app;
+        BLEBase* feature;
+    };
+    inline static std::array<GATTS_Route, ESP_GATT_IF_NONE + 1> gatts_routes{};
     inline static util::Map<uint16_t, std::shared_ptr<GATTS_Profile>> gatts_map;
-    inline static util::Map<uint16_t, std::shared_ptr<CHAR_Profile>> chars_map;
-    inline static util::Map<uint16_t, std::shared_ptr<DESCR_Profile>> descr_map;
+    // 句柄 -> 属性 平铺表，CREATE 时按服务句柄范围扩容，之后只在 BTC 任务中读写
+    inline static std::vector<ATTR_Profile*> attr_table;
 
     inline static esp_bt_controller_config_t adv_config = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
     inline static esp_ble_adv_data_t adv_data;
     inline static esp_ble_adv_params_t adv_params;
     inline static esp_bt_mode_t bt_mode = ESP_BT_MODE_BLE;
     inline static std::string_view ble_name{"ESP32-S3"};
-    inline static uint16_t connect_id;
-    inline static uint16_t current_mtu = 23;
+    // 最快一条连接的参数，报告节拍与统计用
+    inline static std::atomic<uint16_t> conn_interval = 0;
+    inline static std::atomic<uint16_t> conn_latency = 0;
+    inline static std::atomic<uint16_t> conn_timeout = 0;
+    inline static std::atomic<uint8_t> open_connections = 0;
+    inline static uint16_t current_conn_id = 0;
+
+    inline static std::atomic<int64_t> last_activity = 0;
+    inline static esp_timer_handle_t idle_timer = nullptr;
+    inline static std::atomic<uint32_t> conn_requests = 0;
+    inline static std::atomic<uint32_t> conn_accepted = 0;
+    inline static std::atomic<uint32_t> conn_rejected = 0;
+    inline static std::atomic<uint32_t> conn_peer_updates = 0;
+
+    inline static esp_timer_handle_t retry_timer = nullptr;
+    inline static std::atomic<uint32_t> notify_sent = 0;
+    inline static std::atomic<uint32_t> notify_deferred = 0;
+    inline static std::atomic<uint32_t> notify_dropped = 0;
+    inline static std::atomic<uint32_t> notify_stalls = 0;
+    inline static std::atomic<uint32_t> notify_congest = 0;
+    inline static std::atomic<uint32_t> notify_held = 0;
+    inline static std::atomic<uint32_t> notify_merged = 0;
+    inline static std::atomic<uint32_t> notify_unsubscribed = 0;
+    inline static std::atomic<uint32_t> notify_unchanged = 0;
+    inline static std::atomic<int64_t> retry_at = 0;
+    inline static std::atomic<bool> retry_arming = false;
+    inline static std::atomic<uint32_t> notify_max_queue_us = 0;
+    inline static std::atomic<uint64_t> notify_queue_us = 0;
     inline static uint16_t next_app_id = 0;
 
+    static constexpr uint16_t local_mtu = 512;
+    static constexpr uint16_t default_mtu = 23;
+    static constexpr uint16_t default_data_len = 27;
+    static constexpr uint16_t max_data_len = 251;
+
+    struct Connection {
+        bool used;
+        ConnectionInfo info;
+    };
+    // 待发通知，value 只保存不超过 max_queued_payload 的内容
+    struct Outbound {
+        esp_gatt_if_t gatts_if;
+        bool need_confirm;
+        Priority priority;
+        uint16_t handle;
+        uint16_t len;
+        int16_t stamp_offset;
+        uint32_t generation;  // 入队时槽位的连接代数，与当前不符说明属于已断开的连接
+        int64_t queued_at;
+        uint8_t value[max_queued_payload];
+    };
+
+    static auto stamp(const Outbound& _out, uint8_t* value) -> void {
+        if (_out.stamp_offset >= 0 && _out.stamp_offset + sizeof(int64_t) <= _out.len) {
+            const int64_t now = esp_timer_get_time();
+            std::memcpy(value + _out.stamp_offset, &now, sizeof(now));
+        }
+    }
+    static constexpr size_t max_merged = 4;
+    /**
+     * 每条连接的运行状态，任意线程可访问。
+     * active 为最近一次请求的连接参数档位，update_pending 保证每条连接同一时刻只有一个参数请求在途；
+     * lanes 是按优先级分开的发送队列，draining 保证同一时刻只有一个线程在发。
+     * head 为已出队但还没发出的通知，merged 为按特征合并后等待发送的低优先级通知，二者只由持有 draining 的线程访问。
+     */
+    struct ConnControl {
+        std::atomic<bool> open;
+        std::atomic<bool> active;
+        std::atomic<bool> update_pending;
+        std::atomic<bool> congested;
+        std::atomic<bool> stalled;
+        std::atomic<bool> draining;
+        std::atomic<uint32_t> generation;  // 每次有新连接占用此槽时加一
+        std::array<LockFreeQueue<Outbound, CONFIG_BLE_NOTIFY_QUEUE_LENGTH>, priority_count> lanes;
+        Outbound head;
+        bool has_head;
+        std::array<Outbound, max_merged> merged;
+        uint8_t merged_count;
+    };
+    // 连接表，只在 BTC 任务中写，其它线程经 connections_lock 取快照；槽位下标与 conn_control 对应
+    inline static std::array<Connection, max_connections> connections{};
+    inline static std::array<ConnControl, max_connections> conn_control{};
+    inline static SeqLock connections_lock;
+    // SET_PKT_LENGTH_COMPLETE 不带对端地址，同一时刻只让一个 DLE 请求在途，完成或该连接断开后再发下一个；
+    // 只在 BTC 任务中访问
+    static constexpr size_t no_slot = max_connections;
+    inline static std::array<bool, max_connections> dle_wanted{};
+    inline static size_t dle_inflight = no_slot;
+
+    static auto request_conn_params(size_t slot, bool active) -> void {
+        ConnControl& ctl = conn_control[slot];
+        if (ctl.update_pending.exchange(true)) {
+            return;
+        }
+        esp_ble_conn_update_params_t params{};
+        connections_lock.read([&] { std::memcpy(params.bda, connections[slot].info.bda, sizeof(esp_bd_addr_t)); });
+        if (active) {
+            params.min_int = CONFIG_BLE_CONN_ACTIVE_INTERVAL_MIN;
+            params.max_int = CONFIG_BLE_CONN_ACTIVE_INTERVAL_MAX;
+            params.latency = 0;
+        } else {
+            params.min_int = CONFIG_BLE_CONN_IDLE_INTERVAL_MIN;
+            params.max_int = CONFIG_BLE_CONN_IDLE_INTERVAL_MAX;
+            params.latency = CONFIG_BLE_CONN_IDLE_LATENCY;
+        }
+        params.timeout = CONFIG_BLE_CONN_SUPERVISION_TIMEOUT;
+
+        conn_requests.fetch_add(1, std::memory_order_relaxed);
+        if (esp_ble_gap_update_conn_params(&params) != ESP_OK) {
+            conn_rejected.fetch_add(1, std::memory_order_relaxed);
+            ctl.update_pending = false;
+            return;
+        }
+        ctl.active = active;
+    }
+
+    static void idle_check(void*) {
+        const int64_t idle_us = esp_timer_get_time() - last_activity.load(std::memory_order_relaxed);
+        if (idle_us <= CONFIG_BLE_CONN_IDLE_TIMEOUT_MS * 1000ll) {
+            return;
+        }
+        for (size_t slot = 0; slot < max_connections; ++slot) {
+            if (conn_control[slot].open && conn_control[slot].active) {
+                request_conn_params(slot, false);
+            }
+        }
+    }
+
+    static auto link_ready(const ConnControl& ctl, uint16_t conn_id) -> bool {
+        return !ctl.congested.load(std::memory_order_acquire) && esp_ble_get_cur_sendable_packets_num(conn_id) > 0;
+    }
+
+    static auto fnv1a(const uint8_t* data, uint16_t len) -> uint32_t {
+        uint32_t hash = 2166136261u ^ len;
+        for (uint16_t i = 0; i < len; ++i) {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    static auto subscription_value(const ConnectionInfo& info, uint16_t char_handle) -> uint16_t {
+        auto it = std::ranges::find_if(info.subscriptions, [char_handle](const Subscription& sub) { return sub.char_handle == char_handle; });
+        return it != info.subscriptions.end() ? it->value : 0;
+    }
+
+    static auto queued(const ConnControl& ctl) -> bool {
+        return std::ranges::any_of(ctl.lanes, [](const auto& lane) { return lane.size() != 0; });
+    }
+
+    static auto enqueue(size_t slot, const Outbound& _out) -> bool {
+        ConnControl& ctl = conn_control[slot];
+        auto& lane = ctl.lanes[static_cast<size_t>(_out.priority)];
+        if (ctl.stalled.load(std::memory_order_relaxed) || lane.size() != 0) {
+            notify_deferred.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!lane.push(_out)) {
+            notify_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        drain(slot);
+        return true;
+    }
+
+    /// 超长通知不进队列，链路空闲且没有积压时直接发，否则丢弃
+    static auto send_direct(size_t slot, uint16_t conn_id, const Outbound& _out, uint8_t* value) -> bool {
+        ConnControl& ctl = conn_control[slot];
+        if (ctl.stalled.load(std::memory_order_relaxed) || queued(ctl) || !link_ready(ctl, conn_id)) {
+            notify_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        stamp(_out, value);
+        if (esp_ble_gatts_send_indicate(_out.gatts_if, conn_id, _out.handle, _out.len, value, _out.need_confirm) != ESP_OK) {
+            notify_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        notify_sent.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// 尽量发出队列中的通知，任意线程可调用；被暂停时由拥塞解除事件或重试定时器继续
+    static auto drain(size_t slot) -> void {
+        ConnControl& ctl = conn_control[slot];
+        do {
+            if (ctl.draining.exchange(true, std::memory_order_acquire)) {
+                return;
+            }
+            const bool done = drain_locked(slot);
+            ctl.draining.store(false, std::memory_order_release);
+            if (!done) {
+                return;
+            }
+            // 释放 draining 之后才入队的通知由这里补发
+        } while (queued(ctl) && ctl.open.load(std::memory_order_acquire));
+    }
+
+    /// 低优先级通知并入 merged，同一特征只保留最新值，等待时间从最早一次算起
+    static auto merge_telemetry(ConnControl& ctl, bool hid_active) -> void {
+        Outbound out;
+        while (ctl.lanes[static_cast<size_t>(Priority::TELEMETRY)].pop(out)) {
+            if (hid_active) {
+                notify_held.fetch_add(1, std::memory_order_relaxed);
+            }
+            auto end = ctl.merged.begin() + ctl.merged_count;
+            auto it = std::ranges::find_if(ctl.merged.begin(), end, [&](const Outbound& m) { return m.handle == out.handle && m.gatts_if == out.gatts_if && m.generation == out.generation; });
+            if (it != end) {
+                out.queued_at = it->queued_at;
+                *it = out;
+                notify_merged.fetch_add(1, std::memory_order_relaxed);
+            } else if (ctl.merged_count < max_merged) {
+                ctl.merged[ctl.merged_count++] = out;
+            } else {
+                notify_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// 取出下一条要发的通知；低优先级通知在 HID 活跃期间推迟，最多推迟 CONFIG_BLE_TELEMETRY_MAX_DEFER_MS
+    static auto next_outbound(ConnControl& ctl, int64_t now) -> bool {
+        if (ctl.lanes[static_cast<size_t>(Priority::INPUT)].pop(ctl.head) || ctl.lanes[static_cast<size_t>(Priority::ACK)].pop(ctl.head)) {
+            return true;
+        }
+        if (ctl.merged_count == 0) {
+            return false;
+        }
+        const int64_t quiet_at = last_activity.load(std::memory_order_relaxed) + CONFIG_BLE_TELEMETRY_DEFER_MS * 1000ll;
+        const int64_t due_at = std::min<int64_t>(quiet_at, ctl.merged[0].queued_at + CONFIG_BLE_TELEMETRY_MAX_DEFER_MS * 1000ll);
+        if (now < due_at) {
+            arm_retry(due_at - now);
+            return false;
+        }
+        ctl.head = ctl.merged[0];
+        std::move(ctl.merged.begin() + 1, ctl.merged.begin() + ctl.merged_count, ctl.merged.begin());
+        --ctl.merged_count;
+        return true;
+    }
+
+    static auto drain_locked(size_t slot) -> bool {
+        ConnControl& ctl = conn_control[slot];
+        uint16_t conn_id = 0;
+        uint32_t conn_generation = 0;
+        bool known = false;
+        while (ctl.open.load(std::memory_order_acquire)) {
+            // 排空途中槽位可能已换了连接，先读代数再读 ID，保证 ID 不旧于代数
+            const uint32_t generation = ctl.generation.load(std::memory_order_acquire);
+            if (!known || generation != conn_generation) {
+                connections_lock.read([&] { conn_id = connections[slot].info.conn_id; });
+                conn_generation = generation;
+                known = true;
+            }
+            const int64_t now = esp_timer_get_time();
+            merge_telemetry(ctl, now - last_activity.load(std::memory_order_relaxed) < CONFIG_BLE_TELEMETRY_DEFER_MS * 1000ll);
+            if (!ctl.has_head) {
+                if (!next_outbound(ctl, now)) {
+                    ctl.stalled.store(false, std::memory_order_relaxed);
+                    return true;
+                }
+                ctl.has_head = true;
+            }
+            if (ctl.head.generation != generation) {
+                ctl.has_head = false;
+                notify_dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            const bool ready = link_ready(ctl, conn_id);
+            if (ready) {
+                stamp(ctl.head, ctl.head.value);
+            }
+            if (!ready || esp_ble_gatts_send_indicate(ctl.head.gatts_if, conn_id, ctl.head.handle, ctl.head.len, ctl.head.value, ctl.head.need_confirm) != ESP_OK) {
+                if (!ctl.stalled.exchange(true, std::memory_order_relaxed)) {
+                    notify_stalls.fetch_add(1, std::memory_order_relaxed);
+                }
+                // 拥塞由 CONGEST 事件恢复，缓冲耗尽没有事件，按连接间隔重试
+                arm_retry(std::max<uint32_t>(get_conn_interval_us(), 1250));
+                return false;
+            }
+            ctl.has_head = false;
+            const uint32_t queued_us = esp_timer_get_time() - ctl.head.queued_at;
+            notify_sent.fetch_add(1, std::memory_order_relaxed);
+            notify_queue_us.fetch_add(queued_us, std::memory_order_relaxed);
+            if (queued_us > notify_max_queue_us.load(std::memory_order_relaxed)) {
+                notify_max_queue_us.store(queued_us, std::memory_order_relaxed);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 重试定时器只有一个，已经定在更早时刻时不推迟它
+     *
+     * 输入、BTC 和定时器任务都会调用。截止时刻用 CAS 登记，只有抢到 retry_arming 的调用方操作定时器，
+     * 其间别人登记的更早时刻由它在释放后补上，避免两次 stop/start 交错导致后一次启动失败。
+     */
+    static auto arm_retry(int64_t after_us) -> void {
+        const int64_t now = esp_timer_get_time();
+        const int64_t at = now + std::max<int64_t>(after_us, 1);
+        int64_t armed = retry_at.load(std::memory_order_relaxed);
+        do {
+            if (armed > now && armed <= at) {
+                return;
+            }
+        } while (!retry_at.compare_exchange_weak(armed, at, std::memory_order_relaxed));
+
+        int64_t target = 0;
+        do {
+            if (retry_arming.exchange(true, std::memory_order_acquire)) {
+                return;
+            }
+            target = retry_at.load(std::memory_order_relaxed);
+            if (target != 0) {
+                // 定时器未运行时 stop 返回 ESP_ERR_INVALID_STATE，属正常情况
+                esp_timer_stop(retry_timer);
+                const esp_err_t err = esp_timer_start_once(retry_timer, std::max<int64_t>(target - esp_timer_get_time(), 1));
+                if (err != ESP_OK) {
+                    ESP_LOGE("BLE CONN", "重试定时器启动失败: %s;", esp_err_to_name(err));
+                    // 清掉登记，下一次调用会重新启动
+                    int64_t expected = target;
+                    retry_at.compare_exchange_strong(expected, 0, std::memory_order_relaxed);
+                    target = 0;
+                }
+            }
+            retry_arming.store(false, std::memory_order_release);
+        } while (retry_at.load(std::memory_order_relaxed) != target);
+    }
+
+    static void retry_notify(void*) {
+        retry_at.store(0, std::memory_order_relaxed);
+        for (size_t slot = 0; slot < max_connections; ++slot) {
+            if (conn_control[slot].open) {
+                drain(slot);
+            }
+        }
+    }
+
+    static auto find_connection(uint16_t conn_id) -> Connection* {
+        auto it = std::ranges::find_if(connections, [conn_id](const Connection& conn) { return conn.used && conn.info.conn_id == conn_id; });
+        return it != connections.end() ? &*it : nullptr;
+    }
+
+    static auto find_connection(const esp_bd_addr_t bda) -> Connection* {
+        auto it = std::ranges::find_if(connections, [bda](const Connection& conn) { return conn.used && std::memcmp(conn.info.bda, bda, sizeof(esp_bd_addr_t)) == 0; });
+        return it != connections.end() ? &*it : nullptr;
+    }
+
+    static auto slot_of(const Connection* conn) -> size_t {
+        return conn - connections.data();
+    }
+
+    static auto connection_mtu(uint16_t conn_id) -> uint16_t {
+        const Connection* conn = find_connection(conn_id);
+        return conn ? conn->info.mtu : default_mtu;
+    }
+
+    template<typename F>
+    static auto update_connection(Connection* conn, F&& _modify) -> void {
+        if (conn) {
+            SeqLock::WriteGuard wlk(connections_lock);
+            _modify(conn->info);
+        }
+    }
+
+    /// 以最快一条连接的参数作为报告节拍
+    static auto refresh_conn_summary() -> void {
+        const Connection* fastest = nullptr;
+        for (const auto& conn : connections) {
+            if (conn.used && conn.info.interval && (!fastest || conn.info.interval < fastest->info.interval)) {
+                fastest = &conn;
+            }
+        }
+        conn_interval = fastest ? fastest->info.interval : 0;
+        conn_latency = fastest ? fastest->info.latency : 0;
+        conn_timeout = fastest ? fastest->info.timeout : 0;
+    }
+
+    /**
+     * @brief 新连接入表并做链路优化，同一连接在每个应用上各收到一次 CONNECT，只有第一次返回 true
+     *
+     * MTU 交换只能由客户端发起，服务端在 init_ble 中声明 local_mtu，收到 MTU_EVT 后按连接记录。
+     * 这里请求最大数据长度(DLE)，启用 BLE 5.0 特性时再请求 2M PHY。
+     */
+    static auto open_connection(const esp_ble_gatts_cb_param_t::gatts_connect_evt_param& _connect) -> bool {
+        if (find_connection(_connect.conn_id)) {
+            return false;
+        }
+        auto it = std::ranges::find_if(connections, [](const Connection& conn) { return !conn.used; });
+        if (it == connections.end()) {
+            ESP_LOGW("BLE CONN", "连接表已满 ID: %d;", _connect.conn_id);
+            return false;
+        }
+        Connection* conn = &*it;
+        {
+            SeqLock::WriteGuard wlk(connections_lock);
+            conn->used = true;
+            conn->info = {};
+            conn->info.conn_id = _connect.conn_id;
+            std::memcpy(conn->info.bda, _connect.remote_bda, sizeof(esp_bd_addr_t));
+            conn->info.mtu = default_mtu;
+            conn->info.tx_octets = default_data_len;
+            conn->info.rx_octets = default_data_len;
+            conn->info.tx_phy = ESP_BLE_GAP_PHY_1M;
+            conn->info.rx_phy = ESP_BLE_GAP_PHY_1M;
+            conn->info.interval = _connect.conn_params.interval;
+            conn->info.latency = _connect.conn_params.latency;
+            conn->info.timeout = _connect.conn_params.timeout;
+        }
+        ConnControl& ctl = conn_control[slot_of(conn)];
+        ctl.active = false;
+        ctl.update_pending = false;
+        ctl.congested = false;
+        ctl.stalled = false;
+        ctl.generation.fetch_add(1, std::memory_order_release);
+        discard_queued(ctl);
+        ctl.open.store(true, std::memory_order_release);
+        open_connections.fetch_add(1, std::memory_order_relaxed);
+        refresh_conn_summary();
+
+        dle_wanted[slot_of(conn)] = true;
+        request_next_dle();
+#if CONFIG_BLE_PREFER_2M_PHY
+        esp_bd_addr_t peer;
+        std::memcpy(peer, _connect.remote_bda, sizeof(esp_bd_addr_t));
+        if (esp_ble_gap_set_preferred_phy(peer, 0, ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_OPTIONS_NO_PREF) != ESP_OK) {
+            ESP_LOGW("BLE CONN", "2M PHY 请求失败 ID: %d;", _connect.conn_id);
+        }
+#endif
+        return true;
+    }
+
+    /// 连接出表，同一连接只有第一次 DISCONNECT 返回 true
+    static auto close_connection(uint16_t conn_id) -> bool {
+        Connection* conn = find_connection(conn_id);
+        if (!conn) {
+            return false;
+        }
+        const size_t slot = slot_of(conn);
+        conn_control[slot].open.store(false, std::memory_order_release);
+        discard_queued(conn_control[slot]);
+        {
+            SeqLock::WriteGuard wlk(connections_lock);
+            conn->used = false;
+        }
+        open_connections.fetch_sub(1, std::memory_order_relaxed);
+        refresh_conn_summary();
+
+        dle_wanted[slot] = false;
+        if (dle_inflight == slot) {
+            dle_inflight = no_slot;
+            request_next_dle();
+        }
+        return true;
+    }
+
+    /// 清掉槽位里积压的通知；正在排空时拿不到锁，残留的由排空时按代数丢弃
+    static auto discard_queued(ConnControl& ctl) -> void {
+        if (ctl.draining.exchange(true, std::memory_order_acquire)) {
+            return;
+        }
+        Outbound stale;
+        for (auto& lane : ctl.lanes) {
+            while (lane.pop(stale)) {
+            }
+        }
+        ctl.has_head = false;
+        ctl.merged_count = 0;
+        ctl.draining.store(false, std::memory_order_release);
+    }
+
+    /// 没有在途请求时，给下一个等待中的连接发 DLE 请求
+    static auto request_next_dle() -> void {
+        while (dle_inflight == no_slot) {
+            auto it = std::ranges::find(dle_wanted, true);
+            if (it == dle_wanted.end()) {
+                return;
+            }
+            const size_t slot = it - dle_wanted.begin();
+            *it = false;
+            esp_bd_addr_t peer;
+            connections_lock.read([&] { std::memcpy(peer, connections[slot].info.bda, sizeof(esp_bd_addr_t)); });
+            if (esp_ble_gap_set_pkt_data_len(peer, max_data_len) == ESP_OK) {
+                dle_inflight = slot;
+            } else {
+                ESP_LOGW("BLE CONN", "DLE 请求失败 槽位: %d;", static_cast<int>(slot));
+            }
+        }
+    }
+
+    /// 记录某连接对某特征的 CCCD 写入，已加密(绑定)的连接同时保存到文件
+    static auto set_subscription(uint16_t conn_id, uint16_t char_handle, uint16_t value) -> void {
+        Connection* conn = find_connection(conn_id);
+        update_connection(conn, [&](ConnectionInfo& info) {
+            auto& subs = info.subscriptions;
+            auto it = std::ranges::find_if(subs, [&](const Subscription& s) { return s.char_handle == char_handle; });
+            if (it == subs.end()) {
+                it = std::ranges::find_if(subs, [](const Subscription& s) { return s.char_handle == 0; });
+            }
+            if (it == subs.end()) {
+                ESP_LOGW("BLE CONN", "订阅表已满 ID: %d; 句柄: %d;", conn_id, char_handle);
+                return;
+            }
+            *it = value ? Subscription{char_handle, value} : Subscription{};
+        });
+        if (conn && conn->info.encrypted) {
+            remember_subscriptions(conn->info);
+        }
+    }
+
+    /**
+     * 绑定的主机重连后不一定重写 CCCD，按对端地址保存订阅，加密完成后恢复。
+     * 只在 BTC 任务中修改，满了淘汰最早的记录；文件由 save_subscriptions 在主循环中写入。
+     */
+    struct Remembered {
+        esp_bd_addr_t bda;
+        std::array<Subscription, max_subscriptions> subscriptions;
+    };
+    static constexpr size_t max_remembered = 8;
+    static constexpr int64_t cccd_save_delay_us = 1000000;
+    inline static std::array<Remembered, max_remembered> remembered{};
+    inline static SeqLock remembered_lock;
+    inline static std::atomic<bool> remembered_dirty = false;
+    inline static std::atomic<int64_t> remembered_changed_at = 0;
+
+    static auto remember_subscriptions(const ConnectionInfo& info) -> void {
+        auto it = std::ranges::find_if(remembered, [&](const Remembered& r) { return std::memcmp(r.bda, info.bda, sizeof(esp_bd_addr_t)) == 0; });
+        if (it != remembered.end() && it->subscriptions == info.subscriptions) {
+            return;
+        }
+        {
+            SeqLock::WriteGuard wlk(remembered_lock);
+            if (it == remembered.end()) {
+                constexpr esp_bd_addr_t none{};
+                it = std::ranges::find_if(remembered, [&](const Remembered& r) { return std::memcmp(r.bda, none, sizeof(esp_bd_addr_t)) == 0; });
+                if (it == remembered.end()) {
+                    std::move(remembered.begin() + 1, remembered.end(), remembered.begin());
+                    it = remembered.end() - 1;
+                }
+                std::memcpy(it->bda, info.bda, sizeof(esp_bd_addr_t));
+            }
+            it->subscriptions = info.subscriptions;
+        }
+        remembered_changed_at.store(esp_timer_get_time(), std::memory_order_relaxed);
+        remembered_dirty.store(true, std::memory_order_release);
+    }
+
+    static auto restore_subscriptions(Connection* conn) -> void {
+        auto it = std::ranges::find_if(remembered, [&](const Remembered& r) { return std::memcmp(r.bda, conn->info.bda, sizeof(esp_bd_addr_t)) == 0; });
+        if (it == remembered.end()) {
+            // 首次配对前写入的 CCCD 在加密完成后才保存
+            remember_subscriptions(conn->info);
+            return;
+        }
+        update_connection(conn, [&](ConnectionInfo& info) {
+            for (const auto& sub : it->subscriptions) {
+                if (sub.char_handle && subscription_value(info, sub.char_handle) == 0) {
+                    auto slot = std::ranges::find_if(info.subscriptions, [](const Subscription& s) { return s.char_handle == 0; });
+                    if (slot != info.subscriptions.end()) {
+                        *slot = sub;
+                    }
+                }
+            }
+        });
+        remember_subscriptions(conn->info);
+    }
+
+    static auto load_subscriptions() -> void {
+        std::ifstream in("/FATFS/cccd.bin", std::ios::binary);
+        if (in.is_open() && !in.read(reinterpret_cast<char*>(remembered.data()), sizeof(remembered))) {
+            remembered = {};
+        }
+    }
+
+    static auto find_attr(uint16_t handle) -> ATTR_Profile* {
+        return handle < attr_table.size() ? attr_table[handle] : nullptr;
+    }
+
+    static auto bind_attr(uint16_t handle, ATTR_Profile* attr) -> void {
+        if (handle >= attr_table.size()) {
+            attr_table.resize(handle + 1, nullptr);
+        }
+        attr_table[handle] = attr;
+    }
+
     static void gatts_callback(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param) {
         // ESP_LOGI("BLE GATTS", "EVENT: %s; ID: %d;", magic_enum::enum_name<esp_gatts_cb_event_t>(event).data(), param->connect.conn_id);
 
-        if (!gatts_event.empty() || gatts_event.contains(event)) {
+        if (!gatts_event.empty() && gatts_event.contains(event)) {
             return gatts_event[event](event, gatts_if, param);
         }
 
-        auto it = std::ranges::find_if(apps, [&param, &gatts_if](std::shared_ptr<GATTS_Profile>& app) -> bool { return app->gatts_if == gatts_if; });
-        if (it != apps.end()) {
-            if ((*it)->feature->gatts_event_callback(event, gatts_if, param)) {
-                return;
-            }
+        const GATTS_Route& route = gatts_routes[gatts_if];
+        if (route.feature && route.feature->gatts_event_callback(event, gatts_if, param)) {
+            return;
         }
+        GATTS_Profile* app = route.app;
 
         switch (event) {
             case ESP_GATTS_DISCONNECT_EVT: {
-                esp_err_t err = esp_ble_gap_stop_advertising();
-                ESP_ERROR_CHECK(err);
-                err = esp_ble_gap_start_advertising(&adv_params);
-                ESP_ERROR_CHECK(err);
-                connect_id = 0;
-                for (auto& app : apps) {
-                    app->conn_id = connect_id;
+                if (!close_connection(param->disconnect.conn_id)) {
+                    break;
+                }
+                ESP_LOGI("ESP_GATTS_DISCONNECT_EVT", "ID: %d; 原因: 0x%x; 剩余连接: %d;", param->disconnect.conn_id, param->disconnect.reason, open_connections.load());
+                if (open_connections == 0) {
+                    esp_timer_stop(idle_timer);
                 }
+                // 连接表满时停止了广播，有空位后恢复
+                esp_err_t err = esp_ble_gap_start_advertising(&adv_params);
+                ESP_ERROR_CHECK(err);
             } break;
             case ESP_GATTS_CONNECT_EVT: {
+                if (!open_connection(param->connect)) {
+                    break;
+                }
                 ESP_LOGI("ESP_GATTS_CONNECT_EVT",
-                         "ID: %d; Remote Address: %02X:%02X:%02X:%02X:%02X:%02X;",
+                         "ID: %d; Remote Address: %02X:%02X:%02X:%02X:%02X:%02X; 连接数: %d;",
                          param->connect.conn_id,
                          param->connect.remote_bda[5],
                          param->connect.remote_bda[4],
                          param->connect.remote_bda[3],
                          param->connect.remote_bda[2],
                          param->connect.remote_bda[1],
-                         param->connect.remote_bda[0]);
+                         param->connect.remote_bda[0],
+                         open_connections.load());
                 esp_err_t err = esp_ble_set_encryption(param->connect.remote_bda, ESP_BLE_SEC_ENCRYPT);
                 ESP_ERROR_CHECK(err);
-                err = esp_ble_gap_stop_advertising();
+                // 可连接广播在建立连接后由协议栈停止，表内还有空位时继续广播以接受其它主机
+                if (open_connections < max_connections) {
+                    err = esp_ble_gap_start_advertising(&adv_params);
+                } else {
+                    err = esp_ble_gap_stop_advertising();
+                }
                 ESP_ERROR_CHECK(err);
-                connect_id = param->connect.conn_id;
-                for (auto& app : apps) {
-                    app->conn_id = connect_id;
+                // 连接后先用低延迟参数，加快服务发现，空闲后再放宽
+                last_activity = esp_timer_get_time();
+                request_conn_params(slot_of(find_connection(param->connect.conn_id)), true);
+                if (open_connections == 1) {
+                    esp_timer_start_periodic(idle_timer, CONFIG_BLE_CONN_IDLE_TIMEOUT_MS * 1000ull / 4);
                 }
-                esp_ble_gattc_send_mtu_req(gatts_if, connect_id);
             } break;
             case ESP_GATTS_MTU_EVT: {
-                ESP_LOGI("ESP_GATTS_MTU_EVT", "MTU %d;", param->mtu.mtu);
-                current_mtu = param->mtu.mtu;
+                ESP_LOGI("ESP_GATTS_MTU_EVT", "ID: %d; MTU %d;", param->mtu.conn_id, param->mtu.mtu);
+                update_connection(find_connection(param->mtu.conn_id), [&](ConnectionInfo& info) { info.mtu = param->mtu.mtu; });
             } break;
             case ESP_GATTS_REG_EVT: {
-                auto it = std::ranges::find_if(apps, [&param](std::shared_ptr<GATTS_Profile>& app) -> bool { return app->app_id == param->reg.app_id; });
-                if (it != apps.end()) {
-                    (*it)->gatts_if = gatts_if;
-                    esp_ble_gatts_create_service(gatts_if, &(*it)->service_id, (*it)->num_handle);
-                    ESP_LOGI("ESP_GATTS_REG_EVT", "APP ID: %d; GATTS: %d; SERVICE ID: %d;", param->reg.app_id, gatts_if, (*it)->service_id.id);
+                if (param->reg.app_id < apps.size() && gatts_if != ESP_GATT_IF_NONE) {
+                    auto& reg_app = apps[param->reg.app_id];
+                    reg_app->gatts_if = gatts_if;
+                    gatts_routes[gatts_if] = {reg_app.get(), reg_app->feature.get()};
+                    esp_ble_gatts_create_service(gatts_if, &reg_app->service_id, reg_app->num_handle);
+                    ESP_LOGI("ESP_GATTS_REG_EVT", "APP ID: %d; GATTS: %d; SERVICE ID: %d;", param->reg.app_id, gatts_if, reg_app->service_id.id);
                 }
             } break;
             case ESP_GATTS_CREATE_EVT: {
-                if (it != apps.end()) {
+                if (app) {
                     esp_err_t err;
-                    auto service_handle = (*it)->service_handle = param->create.service_handle;
-                    for (auto& char_ : (*it)->chars) {
+                    auto service_handle = app->service_handle = param->create.service_handle;
+                    if (service_handle + app->num_handle > attr_table.size()) {
+                        attr_table.resize(service_handle + app->num_handle, nullptr);
+                    }
+                    for (auto& char_ : app->chars) {
                         err = esp_ble_gatts_add_char(service_handle, &char_->char_uuid, char_->perm, char_->property, &char_->attr_value, NULL);
                         ESP_ERROR_CHECK(err);
                         for (auto& d : char_->descrs) {
@@ -257,61 +1207,92 @@ private:
                             ESP_ERROR_CHECK(err);
                         }
                     }
-                    gatts_map[service_handle] = (*it);
+                    gatts_map[service_handle] = apps[app->app_id];
                     err = esp_ble_gatts_start_service(service_handle);
                     ESP_ERROR_CHECK(err);
-                    ESP_LOGI("ESP_GATTS_CREATE_EVT", "服务ID: %d; 服务启动!", (*it)->service_id.id);
+                    ESP_LOGI("ESP_GATTS_CREATE_EVT", "服务ID: %d; 服务启动!", app->service_id.id);
                 }
             } break;
             case ESP_GATTS_ADD_CHAR_EVT: {
-                auto char_it =
-                        std::ranges::find_if((*it)->chars, [&param](std::shared_ptr<CHAR_Profile>& char_) -> bool { return char_->char_uuid.uuid.uuid16 == param->add_char.char_uuid.uuid.uuid16; });
-                if (char_it == (*it)->chars.end()) {
+                if (!app) {
+                    break;
+                }
+                // 同一服务里可以有多个同 UUID 的特征(HID 报告)，ADD_CHAR 按添加顺序返回，取第一个还没绑定句柄的
+                auto char_it = std::ranges::find_if(app->chars, [&param](std::shared_ptr<CHAR_Profile>& char_) -> bool {
+                    return char_->char_handle == 0 && char_->char_uuid.uuid.uuid16 == param->add_char.char_uuid.uuid.uuid16;
+                });
+                if (char_it == app->chars.end()) {
                     ESP_LOGW("ESP_GATTS_ADD_CHAR_EVT", "未知特征");
                     break;
                 }
 
                 (*char_it)->char_handle = param->add_char.attr_handle;
-                chars_map[(*char_it)->char_handle] = (*char_it);
+                bind_attr((*char_it)->char_handle, char_it->get());
             } break;
             case ESP_GATTS_ADD_CHAR_DESCR_EVT: {
-                for (auto char_it : (*it)->chars) {
-                    auto descr_it = std::ranges::find_if(
-                            char_it->descrs, [&param](std::shared_ptr<DESCR_Profile>& descr_) -> bool { return descr_->descr_uuid.uuid.uuid16 == param->add_char_descr.descr_uuid.uuid.uuid16; });
+                if (!app) {
+                    break;
+                }
+                for (auto char_it : app->chars) {
+                    if (char_it->char_handle == 0) {
+                        continue;
+                    }
+                    auto descr_it = std::ranges::find_if(char_it->descrs, [&param](std::shared_ptr<DESCR_Profile>& descr_) -> bool {
+                        return descr_->descr_handle == 0 && descr_->descr_uuid.uuid.uuid16 == param->add_char_descr.descr_uuid.uuid.uuid16;
+                    });
                     if (descr_it != char_it->descrs.end()) {
                         (*descr_it)->descr_handle = param->add_char_descr.attr_handle;
-                        descr_map[(*descr_it)->descr_handle] = (*descr_it);
+                        if ((*descr_it)->descr_uuid.uuid.uuid16 == ESP_GATT_UUID_CHAR_CLIENT_CONFIG) {
+                            (*descr_it)->cccd_of = char_it->char_handle;
+                        }
+                        bind_attr((*descr_it)->descr_handle, descr_it->get());
                         ESP_LOGI("ESP_GATTS_ADD_CHAR_DESCR_EVT", "已找到特征描述符");
                         break;
                     }
                 }
             } break;
             case ESP_GATTS_READ_EVT: {
-                std::shared_ptr<CHAR_Profile> char_ptr;
-                std::shared_ptr<DESCR_Profile> descr_ptr;
-                if (chars_map.contains(param->read.handle)) {
-                    char_ptr = chars_map[param->read.handle];
-                } else if (descr_map.contains(param->read.handle)) {
-                    descr_ptr = descr_map[param->read.handle];
-                }
-
-                if (!char_ptr && !descr_ptr) {
+                ATTR_Profile* attr_ptr = find_attr(param->read.handle);
+                if (!attr_ptr) {
                     ESP_LOGW("ESP_GATTS_READ_EVT", "未知特征 句柄: %d;", param->read.handle);
                     break;
                 }
+                if (attr_ptr->cccd_of) {
+                    // CCCD 按连接各自保存，不读共享缓冲区
+                    const Connection* conn = find_connection(param->read.conn_id);
+                    const uint16_t value = conn ? subscription_value(conn->info, attr_ptr->cccd_of) : 0;
+                    esp_gatt_rsp_t rsp{};
+                    rsp.attr_value.handle = param->read.handle;
+                    rsp.attr_value.len = param->read.offset < sizeof(value) ? sizeof(value) - param->read.offset : 0;
+                    rsp.attr_value.offset = param->read.offset;
+                    const uint8_t bytes[] = {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8)};
+                    std::memcpy(rsp.attr_value.value, bytes + std::min<uint16_t>(param->read.offset, sizeof(value)), rsp.attr_value.len);
+                    if (param->read.need_rsp) {
+                        esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_OK, &rsp);
+                    }
+                    break;
+                }
+                const uint16_t mtu = connection_mtu(param->read.conn_id);
+                // 读回调在第一段拷贝前执行，按连接区分内容的特征可以先填好缓冲区
+                if (param->read.offset == 0 && attr_ptr->rw_cb) {
+                    current_conn_id = param->read.conn_id;
+                    attr_ptr->rw_cb(ESP_GATTS_READ_EVT);
+                }
 
-                RWLock::ReadLock rlk(char_ptr ? char_ptr->lock : descr_ptr->lock);
-
-                const auto& attr = char_ptr ? char_ptr->attr_value : descr_ptr->attr_value;
+                const auto& attr = attr_ptr->attr_value;
                 uint16_t offset = param->read.offset;
-                uint16_t left = attr.attr_len - offset;
-                uint16_t pkt = std::min(left, uint16_t(current_mtu - 1));
+                uint16_t attr_len = 0;
+                uint16_t pkt = 0;
 
                 esp_gatt_rsp_t rsp{};
+                attr_ptr->lock.read([&] {
+                    attr_len = attr.attr_len;
+                    pkt = offset < attr_len ? std::min(uint16_t(attr_len - offset), uint16_t(mtu - 1)) : 0;
+                    std::memcpy(rsp.attr_value.value, attr.attr_value + offset, pkt);
+                });
                 rsp.attr_value.handle = param->read.handle;
                 rsp.attr_value.len = pkt;
                 rsp.attr_value.offset = offset;
-                std::memcpy(rsp.attr_value.value, attr.attr_value + offset, pkt);
 
                 // ESP_LOGI("ESP_GATTS_READ_EVT",
                 //          "连接ID: %d; ID: %d; 句柄: %d; 长度: %d; 指针: %p; 分段读取 偏移=%d 长度=%d 总=%d;",
@@ -319,7 +1300,7 @@ private:
                 //          param->read.trans_id,
                 //          param->read.handle,
                 //          rsp.attr_value.len,
-                //          char_ptr ? char_ptr->attr_value.attr_value : descr_ptr->attr_value.attr_value,
+                //          attr.attr_value,
                 //          offset,
                 //          pkt,
                 //          attr.attr_len);
@@ -329,30 +1310,15 @@ private:
                     ESP_ERROR_CHECK(err);
                     ESP_LOGI("ESP_GATTS_READ_EVT", "发送成功!");
                 }
-
-                if (offset + pkt >= attr.attr_len) {
-                    if (char_ptr ? char_ptr->rw_cb : descr_ptr->rw_cb) {
-                        char_ptr ? char_ptr->rw_cb(ESP_GATTS_READ_EVT) : descr_ptr->rw_cb(ESP_GATTS_READ_EVT);
-                    }
-                }
             } break;
             case ESP_GATTS_WRITE_EVT: {
-                std::shared_ptr<CHAR_Profile> char_ptr;
-                std::shared_ptr<DESCR_Profile> descr_ptr;
-                if (chars_map.contains(param->write.handle)) {
-                    char_ptr = chars_map[param->write.handle];
-                } else if (descr_map.contains(param->write.handle)) {
-                    descr_ptr = descr_map[param->write.handle];
-                }
-
-                if (!char_ptr && !descr_ptr) {
+                ATTR_Profile* attr_ptr = find_attr(param->write.handle);
+                if (!attr_ptr) {
                     ESP_LOGW("ESP_GATTS_WRITE_EVT", "未知特征 句柄: %d;", param->write.handle);
                     break;
                 }
 
-                RWLock::WriteLock wlk(char_ptr ? char_ptr->lock : descr_ptr->lock);
-
-                auto& attr = char_ptr ? char_ptr->attr_value : descr_ptr->attr_value;
+                auto& attr = attr_ptr->attr_value;
                 uint16_t offset = param->write.offset;
                 uint16_t len = param->write.len;
 
@@ -364,8 +1330,12 @@ private:
                     break;
                 }
 
-                std::memcpy(attr.attr_value + offset, param->write.value, len);
-                attr.attr_len = std::max(attr.attr_len, uint16_t(offset + len));
+                {
+                    SeqLock::WriteGuard wlk(attr_ptr->lock);
+                    std::memcpy(attr.attr_value + offset, param->write.value, len);
+                    // 长写分段累计，普通写入以本次写入长度为准，变长特征据此判断有效数据
+                    attr.attr_len = param->write.is_prep ? std::max(attr.attr_len, uint16_t(offset + len)) : uint16_t(offset + len);
+                }
 
                 // ESP_LOGI("ESP_GATTS_WRITE_EVT",
                 //          "连接ID: %d; ID: %d; 句柄:%d 偏移:%d 长度:%d 累计:%d %s",
@@ -377,18 +1347,22 @@ private:
                 //          attr.attr_len,
                 //          param->write.is_prep ? "(prep)" : "");
 
-                if (param->write.is_prep) {
-                    if (param->write.need_rsp) {
-                        esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, ESP_GATT_OK, nullptr);
-                    }
-                } else {
-                    if (param->write.need_rsp) {
-                        esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, ESP_GATT_OK, nullptr);
+                if (attr_ptr->cccd_of && !param->write.is_prep && len == sizeof(uint16_t)) {
+                    set_subscription(param->write.conn_id, attr_ptr->cccd_of, param->write.value[0] | param->write.value[1] << 8);
+                }
+
+                // 普通写入先执行回调，把回调的结果(如 ESP_GATT_BUSY)作为响应回给主机；长写分段只确认收到
+                esp_gatt_status_t status = ESP_GATT_OK;
+                if (attr_ptr->rw_cb) {
+                    current_conn_id = param->write.conn_id;
+                    const esp_gatt_status_t cb_status = attr_ptr->rw_cb(ESP_GATTS_WRITE_EVT);
+                    if (!param->write.is_prep) {
+                        status = cb_status;
                     }
                 }
 
-                if (char_ptr ? char_ptr->rw_cb : descr_ptr->rw_cb) {
-                    char_ptr ? char_ptr->rw_cb(ESP_GATTS_WRITE_EVT) : descr_ptr->rw_cb(ESP_GATTS_WRITE_EVT);
+                if (param->write.need_rsp) {
+                    esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, nullptr);
                 }
             } break;
             case ESP_GATTS_EXEC_WRITE_EVT: {
@@ -397,6 +1371,19 @@ private:
             } break;
             case ESP_GATTS_CONF_EVT: {
             } break;
+            case ESP_GATTS_CONGEST_EVT: {
+                Connection* conn = find_connection(param->congest.conn_id);
+                if (!conn) {
+                    break;
+                }
+                const size_t slot = slot_of(conn);
+                if (conn_control[slot].congested.exchange(param->congest.congested) != param->congest.congested && param->congest.congested) {
+                    notify_congest.fetch_add(1, std::memory_order_relaxed);
+                }
+                if (!param->congest.congested) {
+                    drain(slot);
+                }
+            } break;
             default:
                 break;
         }
@@ -405,12 +1392,17 @@ private:
     static void gap_callback(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
         // ESP_LOGI("BLE GAP", "EVENT: %s", magic_enum::enum_name<esp_gap_ble_cb_event_t>(event).data());
 
-        if (!gap_event.empty() || gap_event.contains(event)) {
+        if (!gap_event.empty() && gap_event.contains(event)) {
             return gap_event[event](event, param);
         }
 
         switch (event) {
             case ESP_GAP_BLE_AUTH_CMPL_EVT: {
+                Connection* conn = find_connection(param->ble_security.auth_cmpl.bd_addr);
+                update_connection(conn, [&](ConnectionInfo& info) { info.encrypted = param->ble_security.auth_cmpl.success; });
+                if (conn && param->ble_security.auth_cmpl.success) {
+                    restore_subscriptions(conn);
+                }
                 if (param->ble_security.auth_cmpl.success) {
                     ESP_LOGI("ESP_GAP_BLE_AUTH_CMPL_EVT", "JustWorks pairing success");
                 } else {
@@ -423,7 +1415,67 @@ private:
                 ESP_ERROR_CHECK(err);
             } break;
             case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT: {
+                const auto& update = param->update_conn_params;
+                Connection* conn = find_connection(update.bda);
+                if (!conn) {
+                    break;
+                }
+                ConnControl& ctl = conn_control[slot_of(conn)];
+                const bool ours = ctl.update_pending.exchange(false);
+                if (update.status == ESP_BT_STATUS_SUCCESS) {
+                    update_connection(conn, [&](ConnectionInfo& info) {
+                        info.interval = update.conn_int;
+                        info.latency = update.latency;
+                        info.timeout = update.timeout;
+                    });
+                    refresh_conn_summary();
+                    if (!ours) {
+                        conn_peer_updates.fetch_add(1, std::memory_order_relaxed);
+                    } else if (!ctl.active || (update.conn_int <= CONFIG_BLE_CONN_ACTIVE_INTERVAL_MAX && update.latency == 0)) {
+                        conn_accepted.fetch_add(1, std::memory_order_relaxed);
+                    } else {
+                        conn_rejected.fetch_add(1, std::memory_order_relaxed);
+                    }
+                } else if (ours) {
+                    conn_rejected.fetch_add(1, std::memory_order_relaxed);
+                }
+                ESP_LOGI("ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT",
+                         "%s 状态: %d; 间隔: %.2f ms; 从机延迟: %d; 超时: %d ms;",
+                         ours ? "请求" : "主机",
+                         param->update_conn_params.status,
+                         param->update_conn_params.conn_int * 1.25f,
+                         param->update_conn_params.latency,
+                         param->update_conn_params.timeout * 10);
+            } break;
+            case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT: {
+                const auto& cmpl = param->pkt_data_length_cmpl;
+                // 不是我们发起的请求(或请求所属连接已断开)的结果不归属任何连接
+                if (dle_inflight == no_slot) {
+                    ESP_LOGW("ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT", "没有等待中的 DLE 请求");
+                    break;
+                }
+                if (cmpl.status == ESP_BT_STATUS_SUCCESS) {
+                    update_connection(&connections[dle_inflight], [&](ConnectionInfo& info) {
+                        info.tx_octets = cmpl.params.tx_len;
+                        info.rx_octets = cmpl.params.rx_len;
+                    });
+                }
+                dle_inflight = no_slot;
+                request_next_dle();
+                ESP_LOGI("ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT", "状态: %d; TX: %d; RX: %d;", cmpl.status, cmpl.params.tx_len, cmpl.params.rx_len);
+            } break;
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+            case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT: {
+                const auto& phy = param->phy_update;
+                if (phy.status == ESP_BT_STATUS_SUCCESS) {
+                    update_connection(find_connection(phy.bda), [&](ConnectionInfo& info) {
+                        info.tx_phy = phy.tx_phy;
+                        info.rx_phy = phy.rx_phy;
+                    });
+                }
+                ESP_LOGI("ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT", "状态: %d; TX PHY: %d; RX PHY: %d;", phy.status, phy.tx_phy, phy.rx_phy);
             } break;
+#endif
             case ESP_GAP_BLE_PASSKEY_REQ_EVT:
             case ESP_GAP_BLE_NC_REQ_EVT:
             case ESP_GAP_BLE_KEY_EVT:
@@ -435,6 +1487,7 @@ private:
     static void init_ble() {
         esp_err_t err;
         load_or_generate_addr();
+        load_subscriptions();
         err = esp_bt_controller_init(&adv_config);
         ESP_ERROR_CHECK(err);
         err = esp_bt_controller_enable(bt_mode);
@@ -459,7 +1512,7 @@ private:
             err = esp_ble_gatts_app_register(app->app_id);
             ESP_ERROR_CHECK(err);
         }
-        err = esp_ble_gatt_set_local_mtu(512);
+        err = esp_ble_gatt_set_local_mtu(local_mtu);
         ESP_ERROR_CHECK(err);
         err = esp_ble_gap_start_advertising(&adv_params);
         ESP_ERROR_CHECK(err);
@@ -539,5 +1592,5 @@ private:
     auto register_ble_messages(std::shared_ptr<GATTS_Profile> _profile) -> void override {                                                                                                             \
         app_ = _profile;
 #define BLE_MSG_FUNC(func) esp_gatt_status_t func(esp_gatts_cb_event_t event)
-#define BLE_MSG(func) [this](esp_gatts_cb_event_t hid_info_msg) -> esp_gatt_status_t { return this->func(hid_info_msg); }
+#define BLE_MSG(func) RW_Callback::bind<&std::remove_pointer_t<decltype(this)>::func>(this)
 #define BLE_MSG_END }
@@ -5,7 +5,7 @@ void Battery::notify() {
 }
 
 void Battery::send_notification() {
-    esp_ble_gatts_send_indicate(app_->gatts_if, app_->conn_id, battery_char_->char_handle, sizeof(level_), &level_, false);
+    send(app_, battery_char_);
 }
 
 auto Battery::registrator() -> void {
@@ -16,6 +16,8 @@ public:
 
     BLE_MSG_BEGIN;
     battery_char_ = register_char(_profile, level_, nullptr, ESP_GATT_UUID_BATTERY_LEVEL, ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
+    battery_char_->priority = Priority::TELEMETRY;
+    battery_char_->skip_unchanged = true;
     battery_descr_ = register_descr(_profile, battery_char_, ccc, nullptr, ESP_GATT_UUID_CHAR_CLIENT_CONFIG, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
     BLE_MSG_END;
 
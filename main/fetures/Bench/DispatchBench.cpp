@@ -0,0 +1,335 @@
+#include "DispatchBench.hpp"
+
+#if CONFIG_BLE_DISPATCH_BENCH
+#include <atomic>
+#include <bit>
+#include "esp_app_desc.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "../../rwlock.hpp"
+#include "../HID/Mixer.hpp"
+#include "../Event/Event.hpp"
+#include "../Input/Input.hpp"
+
+namespace {
+    std::atomic<uint32_t> heap_allocs{0};
+    volatile uintptr_t sink;
+
+    struct Noop {
+        esp_gatt_status_t on_rw(esp_gatts_cb_event_t) {
+            return ESP_GATT_OK;
+        }
+    } noop_target;
+} // namespace
+
+// CONFIG_HEAP_USE_HOOKS 回调，只计数，不能在这里再申请内存
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+    heap_allocs.fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" IRAM_ATTR void esp_heap_trace_free_hook(void* ptr) {
+}
+
+auto DispatchBench::lock_count() -> uint32_t {
+    return RWLock::acquisitions.load(std::memory_order_relaxed) + SeqLock::acquisitions.load(std::memory_order_relaxed);
+}
+
+auto DispatchBench::stress(uint32_t iterations, bool locked) -> json {
+    struct Pattern {
+        uint32_t words[4];
+    };
+    Pattern shared{};
+    SeqLock lock;
+    std::atomic<bool> stop{false};
+    std::atomic<uint32_t> writes{0};
+
+    // 两个写者各自写入带标签的整块数据，读者只要看到不一致的字就是撕裂
+    auto writer = [&](uint32_t tag) {
+        uint32_t n = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            Pattern next;
+            std::fill(std::begin(next.words), std::end(next.words), tag << 24 | (++n & 0xFFFFFF));
+            if (locked) {
+                SeqLock::WriteGuard wlk(lock);
+                std::memcpy(&shared, &next, sizeof(next));
+            } else {
+                std::memcpy(&shared, &next, sizeof(next));
+            }
+            writes.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+    std::thread w1(writer, 1);
+    std::thread w2(writer, 2);
+
+    uint32_t torn = 0;
+    uint64_t retries = 0;
+    uint32_t max_retries = 0;
+    int64_t max_read_us = 0;
+    for (uint32_t i = 0; i < iterations; ++i) {
+        Pattern copy;
+        const int64_t start = esp_timer_get_time();
+        const uint32_t r = locked ? lock.read([&] { std::memcpy(&copy, &shared, sizeof(copy)); }) : (std::memcpy(&copy, &shared, sizeof(copy)), 0);
+        max_read_us = std::max(max_read_us, esp_timer_get_time() - start);
+        retries += r;
+        max_retries = std::max(max_retries, r);
+        if (!std::all_of(std::begin(copy.words), std::end(copy.words), [&](uint32_t w) { return w == copy.words[0]; })) {
+            ++torn;
+        }
+    }
+    stop = true;
+    w1.join();
+    w2.join();
+
+    return {
+            {"reads", iterations},
+            {"writes", writes.load()},
+            {"torn_reads", torn},
+            {"retries_per_read", static_cast<double>(retries) / iterations},
+            {"max_retries", max_retries},
+            {"max_read_us", max_read_us},
+    };
+}
+
+auto DispatchBench::mixer_stress(uint32_t iterations) -> json {
+    constexpr uint32_t producers = 3;
+    Mixer mixer;
+    std::atomic<uint32_t> running{producers};
+
+    auto producer = [&] {
+        for (uint32_t i = 0; i < iterations; ++i) {
+            mixer.add(1, -1, 0);
+            if ((i & 63) == 0) {
+                mixer.click(1);
+            }
+        }
+        running.fetch_sub(1, std::memory_order_release);
+    };
+    std::thread threads[producers] = {std::thread(producer), std::thread(producer), std::thread(producer)};
+
+    // 单一发送者：与生产者并发取帧，直到生产者结束且混合器清空
+    int64_t x = 0;
+    int64_t y = 0;
+    uint32_t presses = 0;
+    uint32_t frames = 0;
+    const int64_t start = esp_timer_get_time();
+    while (running.load(std::memory_order_acquire) || mixer.pending()) {
+        const auto frame = mixer.take();
+        x += frame.x;
+        y += frame.y;
+        presses += std::popcount(frame.button);
+        ++frames;
+    }
+    const int64_t elapsed = esp_timer_get_time() - start;
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    const int64_t expected = static_cast<int64_t>(producers) * iterations;
+    return {
+            {"submitted", expected},
+            {"lost_x", expected - x},
+            {"lost_y", -expected - y},
+            {"clicks_submitted", producers * ((iterations + 63) / 64)},
+            {"clicks_emitted", presses},
+            {"frames", frames},
+            {"ns_per_submit", static_cast<double>(elapsed) * 1000.0 / expected},
+    };
+}
+
+auto DispatchBench::find_target() -> std::optional<Target> {
+    for (auto& app : BLEBase::apps) {
+        for (auto& char_ : app->chars) {
+            if (char_->char_handle != 0 && !char_->rw_cb) {
+                return Target{app, char_};
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+auto DispatchBench::ready() -> bool {
+    if (BLEBase::apps.empty()) {
+        return false;
+    }
+    for (auto& app : BLEBase::apps) {
+        for (auto& char_ : app->chars) {
+            if (char_->char_handle == 0) {
+                return false;
+            }
+        }
+    }
+    return find_target().has_value();
+}
+
+template<typename F>
+auto DispatchBench::measure(uint32_t iterations, F&& body) -> json {
+    const uint32_t allocs = heap_allocs.load(std::memory_order_relaxed);
+    const uint32_t locks = lock_count();
+    const int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        body(i);
+    }
+    const int64_t elapsed = esp_timer_get_time() - start;
+
+    const double n = iterations;
+    return {
+            {"ns_per_event", static_cast<double>(elapsed) * 1000.0 / n},
+            {"allocs_per_event", (heap_allocs.load(std::memory_order_relaxed) - allocs) / n},
+            {"locks_per_event", (lock_count() - locks) / n},
+    };
+}
+
+auto DispatchBench::run(uint32_t iterations) -> std::string {
+    auto target = find_target();
+    if (!target) {
+        return R"({"error":"no target characteristic"})";
+    }
+
+    auto& [app, char_] = *target;
+    const uint16_t handle = char_->char_handle;
+
+    // 写回特征当前的值，基准测试不改变任何状态
+    std::vector<uint8_t> payload(char_->attr_value.attr_value, char_->attr_value.attr_value + char_->attr_value.attr_len);
+
+    esp_ble_gatts_cb_param_t write{};
+    write.write.handle = handle;
+    write.write.len = payload.size();
+    write.write.value = payload.data();
+    write.write.need_rsp = false;
+
+    esp_ble_gatts_cb_param_t read{};
+    read.read.handle = handle;
+    read.read.need_rsp = false;
+
+    const std::function<esp_gatt_status_t(esp_gatts_cb_event_t)> noop = [](esp_gatts_cb_event_t) -> esp_gatt_status_t { return ESP_GATT_OK; };
+    const auto rw_noop = BLEBase::RW_Callback::bind<&Noop::on_rw>(&noop_target);
+
+    // 旧的 chars_map 布局，只作为 table_lookup 的对照
+    util::Map<uint16_t, std::shared_ptr<BLEBase::CHAR_Profile>> chars_map;
+    for (auto& a : BLEBase::apps) {
+        for (auto& c : a->chars) {
+            chars_map[c->char_handle] = c;
+        }
+    }
+
+    json phases;
+    phases["map_lookup"] = measure(iterations, [&](uint32_t) {
+        if (chars_map.contains(handle)) {
+            sink = reinterpret_cast<uintptr_t>(chars_map[handle].get());
+        }
+    });
+    phases["table_lookup"] = measure(iterations, [&](uint32_t) { sink = reinterpret_cast<uintptr_t>(BLEBase::find_attr(handle)); });
+    phases["shared_ptr_copy"] = measure(iterations, [&](uint32_t) {
+        std::shared_ptr<BLEBase::CHAR_Profile> copy = char_;
+        sink = reinterpret_cast<uintptr_t>(copy.get());
+    });
+    RWLock rwlock;
+    phases["rwlock"] = measure(iterations, [&](uint32_t) { RWLock::WriteLock wlk(rwlock); });
+    phases["seqlock_write"] = measure(iterations, [&](uint32_t) { SeqLock::WriteGuard wlk(char_->lock); });
+    phases["seqlock_read"] = measure(iterations, [&](uint32_t) { sink = char_->lock.read([] {}); });
+    phases["std_function"] = measure(iterations, [&](uint32_t) { sink = noop(ESP_GATTS_WRITE_EVT); });
+    phases["write_dispatch"] = measure(iterations, [&](uint32_t) { BLEBase::gatts_callback(ESP_GATTS_WRITE_EVT, app->gatts_if, &write); });
+    phases["rw_callback"] = measure(iterations, [&](uint32_t) { sink = rw_noop(ESP_GATTS_WRITE_EVT); });
+    phases["read_dispatch"] = measure(iterations, [&](uint32_t) { BLEBase::gatts_callback(ESP_GATTS_READ_EVT, app->gatts_if, &read); });
+
+    // 临时挂上空回调，测量带回调的完整写路径
+    char_->rw_cb = rw_noop;
+    phases["write_dispatch_cb"] = measure(iterations, [&](uint32_t) { BLEBase::gatts_callback(ESP_GATTS_WRITE_EVT, app->gatts_if, &write); });
+    char_->rw_cb = nullptr;
+
+    // Event MOVE 写入：BTC 任务被写回调占用的时长，±1000 像素交替，净位移为 0
+    for (auto& a : BLEBase::apps) {
+        for (auto& c : a->chars) {
+            if (c->char_uuid.uuid.uuid16 != 0xEF02 || !c->rw_cb) {
+                continue;
+            }
+            int32_t move[2] = {1000, 0};
+            esp_ble_gatts_cb_param_t move_write{};
+            move_write.write.handle = c->char_handle;
+            move_write.write.len = sizeof(move);
+            move_write.write.value = reinterpret_cast<uint8_t*>(move);
+            phases["event_move_write"] = measure(std::min<uint32_t>(iterations, 200), [&](uint32_t i) {
+                move[0] = i & 1 ? -1000 : 1000;
+                BLEBase::gatts_callback(ESP_GATTS_WRITE_EVT, a->gatts_if, &move_write);
+            });
+        }
+    }
+
+    const auto input = Input::instance()->get_stats();
+    const auto conn = BLEBase::get_conn_stats();
+    const auto notify = BLEBase::get_notify_stats();
+    const auto latency = Event::instance()->get_latency();
+    json links = json::array();
+    for (const auto& link : BLEBase::get_connections()) {
+        links.push_back({
+                {"conn_id", link.conn_id},
+                {"mtu", link.mtu},
+                {"tx_octets", link.tx_octets},
+                {"rx_octets", link.rx_octets},
+                {"tx_phy", link.tx_phy},
+                {"rx_phy", link.rx_phy},
+                {"interval", link.interval},
+                {"latency", link.latency},
+                {"encrypted", link.encrypted},
+        });
+    }
+    json result = {
+            {"firmware", esp_app_get_description()->version},
+            {"iterations", iterations},
+            {"handle", handle},
+            {"phases", phases},
+            {"input",
+             {
+                     {"submitted", input.submitted},
+                     {"dropped", input.dropped},
+                     {"executed", input.executed},
+                     {"max_depth", input.max_depth},
+                     {"reports", input.reports},
+                     {"timed", input.timed},
+                     {"late", input.late},
+                     {"max_late_us", input.max_late_us},
+                     {"keys", input.keys},
+             }},
+            {"conn",
+             {
+                     {"interval", conn.interval},
+                     {"latency", conn.latency},
+                     {"connections", conn.connections},
+                     {"active", conn.active},
+                     {"requests", conn.requests},
+                     {"accepted", conn.accepted},
+                     {"rejected", conn.rejected},
+                     {"links", links},
+             }},
+            {"notify",
+             {
+                     {"sent", notify.sent},
+                     {"deferred", notify.deferred},
+                     {"dropped", notify.dropped},
+                     {"stalls", notify.stalls},
+                     {"congest_events", notify.congest_events},
+                     {"held", notify.held},
+                     {"merged", notify.merged},
+                     {"unsubscribed", notify.unsubscribed},
+                     {"unchanged", notify.unchanged},
+                     {"depth", notify.depth},
+                     {"max_queue_us", notify.max_queue_us},
+                     {"avg_queue_us", notify.avg_queue_us},
+             }},
+            {"latency",
+             {
+                     {"samples", latency.samples},
+                     {"queue", {{"p50", latency.queue_p50}, {"p99", latency.queue_p99}, {"p999", latency.queue_p999}}},
+                     {"emit", {{"p50", latency.emit_p50}, {"p99", latency.emit_p99}, {"p999", latency.emit_p999}}},
+                     {"total", {{"p50", latency.total_p50}, {"p99", latency.total_p99}, {"p999", latency.total_p999}}},
+             }},
+            {"stress",
+             {
+                     {"seqlock", stress(iterations / 10, true)},
+                     {"unlocked", stress(iterations / 10, false)},
+                     {"mixer", mixer_stress(iterations / 10)},
+             }},
+    };
+    return result.dump();
+}
+#endif
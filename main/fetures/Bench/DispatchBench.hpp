@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include "../BLE.hpp"
+#include "../../json.hpp"
+
+/**
+ * @brief GATTS 事件分发基准测试
+ *
+ * 在目标板上用合成的 READ/WRITE 事件直接驱动 BLEBase::gatts_callback，
+ * 并把分发路径拆成若干阶段单独计时，输出每事件耗时(ns)、堆分配次数和加锁次数。
+ * 结果为 JSON，便于在不同固件版本之间直接 diff。
+ */
+class DispatchBench {
+public:
+    DispatchBench() = delete;
+    ~DispatchBench() = delete;
+
+    /// 服务与特征句柄是否已全部就绪
+    static auto ready() -> bool;
+
+    /**
+     * @brief 运行全部阶段
+     * @param iterations 每个阶段的事件数
+     * @return JSON 字符串
+     */
+    static auto run(uint32_t iterations) -> std::string;
+
+private:
+    using json = nlohmann::json;
+
+    struct Target {
+        std::shared_ptr<BLEBase::GATTS_Profile> app;
+        std::shared_ptr<BLEBase::CHAR_Profile> char_;
+    };
+
+    static auto find_target() -> std::optional<Target>;
+    static auto lock_count() -> uint32_t;
+
+    /**
+     * @brief 两个写者 + 一个读者并发访问同一块报告缓冲区
+     * @param locked 是否经由 SeqLock，false 时作为撕裂对照
+     */
+    static auto stress(uint32_t iterations, bool locked) -> json;
+
+    /// 三个生产者并发提交位移与点击，单一发送者取帧，核对总量是否守恒
+    static auto mixer_stress(uint32_t iterations) -> json;
+
+    template<typename F>
+    static auto measure(uint32_t iterations, F&& body) -> json;
+};
@@ -1,4 +1,5 @@
 #include "./Event.hpp"
+#include "esp_timer.h"
 
 Event::Event() {
     touch();
@@ -10,4 +11,342 @@ Event::~Event() {
 
 void Event::registrator() {
     register_ble();
+    Input::on_probe(&Event::probe_done);
+}
+
+auto Event::caller_stats() -> PeerStats* {
+    const auto caller = caller_slot();
+    if (!caller) {
+        return nullptr;
+    }
+    PeerStats& peer = peer_stats[caller->slot];
+    if (peer.generation != caller->generation) {
+        peer = {caller->generation, false, {}};
+    }
+    return &peer;
+}
+
+void Event::load_stats(PeerStats& peer) {
+    const auto input = Input::instance()->get_stats();
+    peer.stats.timed = input.timed;
+    peer.stats.timed_late = input.late;
+    peer.stats.timed_dropped = input.timed_dropped;
+    peer.stats.max_late_us = input.max_late_us;
+    peer.stats.avg_late_us = input.avg_late_us;
+    peer.stats.keys = input.keys;
+    peer.stats.keys_per_second = input.keys_per_second;
+    update(stats_char, [&] { stats_data = peer.stats; });
+}
+
+void Event::report(PeerStats& peer) {
+    load_stats(peer);
+    send(app_, stats_char, caller_conn_id());
+}
+
+esp_gatt_status_t Event::stats_read(esp_gatts_cb_event_t event) {
+    if (PeerStats* peer = caller_stats()) {
+        load_stats(*peer);
+    }
+    return ESP_GATT_OK;
+}
+
+void Event::track(const std::shared_ptr<CHAR_Profile>& char_, size_t full_len, uint16_t seq, bool accepted) {
+    if (char_->attr_value.attr_len >= full_len) {
+        record(seq, accepted);
+    } else if (!accepted) {
+        if (PeerStats* peer = caller_stats()) {
+            ++peer->stats.busy;
+            report(*peer);
+        }
+    }
+}
+
+void Event::record(uint16_t seq, bool accepted) {
+    PeerStats* peer = caller_stats();
+    if (!peer) {
+        return;
+    }
+    STATS_Data& stats = peer->stats;
+    bool notify = !accepted;
+    ++stats.received;
+    if (!accepted) {
+        ++stats.busy;
+    }
+    if (!peer->seq_synced) {
+        peer->seq_synced = true;
+        stats.last_seq = seq;
+    } else {
+        // 16 位序号回绕，按有符号差值判断前后
+        const auto delta = static_cast<int16_t>(seq - stats.last_seq);
+        if (delta <= 0) {
+            ++stats.stale;
+            notify = true;
+        } else {
+            if (delta > 1) {
+                ++stats.gaps;
+                stats.lost += delta - 1;
+                notify = true;
+            }
+            stats.last_seq = seq;
+        }
+    }
+
+    // 出现异常立即通知，否则每 64 条汇报一次；输入引擎的统计只在发出前同步，不给每条命令多加一次写锁
+    if (notify || (stats.received & 63) == 0) {
+        report(*peer);
+    }
+}
+
+esp_gatt_status_t Event::batch_event(esp_gatts_cb_event_t event) {
+    const bool has_delay = batch_data.flags & BATCH_DELAY;
+    const bool has_seq = batch_data.flags & BATCH_SEQ;
+    const size_t stride = sizeof(BATCH_Sample) + (has_delay ? sizeof(uint16_t) : 0);
+    const size_t len = batch_char->attr_value.attr_len;
+    const size_t body = 2 + batch_data.count * stride;
+    if (len < 2 || body + (has_seq ? sizeof(uint16_t) : 0) > len) {
+        ESP_LOGW("Event", "批量数据长度不符 数量:%d 长度:%d", batch_data.count, len);
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+
+    uint16_t seq = 0;
+    if (has_seq) {
+        std::memcpy(&seq, reinterpret_cast<const uint8_t*>(&batch_data) + body, sizeof(seq));
+    }
+
+    // 整批要么全部入队要么全部拒绝，避免主机重发时把已入队的前半批再执行一次
+    auto input = Input::instance();
+    if (input->available() < batch_data.count) {
+        if (has_seq) {
+            record(seq, false);
+        }
+        return ESP_GATT_BUSY;
+    }
+    for (uint8_t i = 0; i < batch_data.count; ++i) {
+        const uint8_t* raw = batch_data.samples + i * stride;
+        BATCH_Sample sample;
+        std::memcpy(&sample, raw, sizeof(sample));
+        uint16_t delay_us = 0;
+        if (has_delay) {
+            std::memcpy(&delay_us, raw + sizeof(sample), sizeof(delay_us));
+        }
+
+        if (!input->submit({.type = Input::Command::SAMPLE, .button = sample.button, .wheel = sample.wheel, .delay_us = delay_us, .x = sample.x, .y = sample.y})) {
+            if (has_seq) {
+                record(seq, false);
+            }
+            return ESP_GATT_BUSY;
+        }
+    }
+    if (has_seq) {
+        record(seq, true);
+    }
+    return ESP_GATT_OK;
+}
+
+esp_gatt_status_t Event::timed_event(esp_gatts_cb_event_t event) {
+    const bool has_seq = timed_data.flags & BATCH_SEQ;
+    const size_t len = timed_char->attr_value.attr_len;
+    const size_t body = 2 + timed_data.count * sizeof(TIMED_Entry);
+    if (len < 2 || body + (has_seq ? sizeof(uint16_t) : 0) > len) {
+        ESP_LOGW("Event", "定时数据长度不符 数量:%d 长度:%d", timed_data.count, len);
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+
+    uint16_t seq = 0;
+    if (has_seq) {
+        std::memcpy(&seq, reinterpret_cast<const uint8_t*>(&timed_data) + body, sizeof(seq));
+    }
+
+    // 整批要么全部入队要么全部拒绝，避免主机重发时把已入队的前半批再执行一次
+    auto input = Input::instance();
+    if (input->available() < timed_data.count) {
+        if (has_seq) {
+            record(seq, false);
+        }
+        return ESP_GATT_BUSY;
+    }
+    for (uint8_t i = 0; i < timed_data.count; ++i) {
+        TIMED_Entry entry;
+        std::memcpy(&entry, timed_data.samples + i * sizeof(TIMED_Entry), sizeof(entry));
+        // at_us 为 0 表示立即执行，定时命令至少为 1
+        const int64_t at_us = std::max<int64_t>(entry.at_us, 1);
+        if (!input->submit({.type = Input::Command::SAMPLE, .button = entry.button, .wheel = entry.wheel, .x = entry.x, .y = entry.y, .at_us = at_us})) {
+            if (has_seq) {
+                record(seq, false);
+            }
+            return ESP_GATT_BUSY;
+        }
+    }
+    if (has_seq) {
+        record(seq, true);
+    }
+    return ESP_GATT_OK;
+}
+
+esp_gatt_status_t Event::time_event(esp_gatts_cb_event_t event) {
+    const int64_t t2 = esp_timer_get_time();
+    if (time_char->attr_value.attr_len < sizeof(time_data.t1)) {
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    // 回复走通知，没订阅的主机收不到，明确告诉它 CCCD 没配置
+    if (!subscribed(time_char, caller_conn_id())) {
+        return ESP_GATT_CCC_CFG_ERR;
+    }
+    // t3 在通知出队交给协议栈时由 stamp_offset 写入，这里先填 t2 占位
+    update(time_char, [&] {
+        time_data.t2 = t2;
+        time_data.t3 = t2;
+        time_char->attr_value.attr_len = sizeof(time_data);
+    });
+    return send(app_, time_char, caller_conn_id()) ? ESP_GATT_OK : ESP_GATT_BUSY;
+}
+
+esp_gatt_status_t Event::text_event(esp_gatts_cb_event_t event) {
+    const size_t len = text_char->attr_value.attr_len;
+    const bool has_seq = text_data.mode & TEXT_SEQ;
+    if (len < 1 + (has_seq ? sizeof(uint16_t) : 0)) {
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    const size_t body = len - 1 - (has_seq ? sizeof(uint16_t) : 0);
+    uint16_t seq = 0;
+    if (has_seq) {
+        std::memcpy(&seq, text_data.data + body, sizeof(seq));
+    }
+
+    // 逐个解出按键交给 f，返回无法映射的字符数
+    const uint8_t mode = text_data.mode & ~TEXT_SEQ;
+    auto for_each_key = [&](auto&& f) -> uint32_t {
+        uint32_t unmapped = 0;
+        if (mode == TEXT_KEYCODES) {
+            for (size_t i = 0; i + 1 < body; i += 2) {
+                f(keymap::Key{text_data.data[i + 1], text_data.data[i]});
+            }
+            return unmapped;
+        }
+        for (size_t i = 0; i < body;) {
+            const uint8_t lead = text_data.data[i];
+            // 多字节 UTF-8 序列整体跳过
+            const size_t width = lead < 0x80 ? 1 : lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+            i += width;
+            if (lead == '\r') {
+                continue;
+            }
+            const keymap::Key key = width == 1 ? keymap::lookup(lead) : keymap::Key{};
+            if (key.usage == 0) {
+                ++unmapped;
+                continue;
+            }
+            f(key);
+        }
+        return unmapped;
+    };
+
+    size_t count = 0;
+    const uint32_t unmapped = for_each_key([&](const keymap::Key&) { ++count; });
+    if (unmapped) {
+        if (PeerStats* peer = caller_stats()) {
+            peer->stats.text_unmapped += unmapped;
+        }
+    }
+
+    // 整段文本要么全部入队要么全部拒绝，避免主机重发时重复输入；
+    // 真正的瓶颈是键盘缓冲区(每帧只发出几个键)，按键从入队到发出都占着预留
+    auto input = Input::instance();
+    auto hid = HID::instance();
+    if (input->available() < count || !hid->reserve_keys(count)) {
+        if (has_seq) {
+            record(seq, false);
+        }
+        return ESP_GATT_BUSY;
+    }
+    size_t submitted = 0;
+    bool full = false;
+    for_each_key([&](const keymap::Key& key) {
+        if (full || !input->submit({.type = Input::Command::KEY, .button = key.modifier, .x = key.usage})) {
+            full = true;
+            return;
+        }
+        ++submitted;
+    });
+    if (submitted < count) {
+        // 只有其他生产者并发占满输入队列时才会走到这里，未投递的按键归还预留
+        hid->release_keys(count - submitted);
+        if (has_seq) {
+            record(seq, false);
+        }
+        return ESP_GATT_BUSY;
+    }
+    if (has_seq) {
+        record(seq, true);
+    }
+    return ESP_GATT_OK;
+}
+
+esp_gatt_status_t Event::probe_event(esp_gatts_cb_event_t event) {
+    const int64_t rx_us = esp_timer_get_time();
+    if (probe_char->attr_value.attr_len < sizeof(probe_data.id)) {
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    PROBE_Data probe{};
+    probe_char->lock.read([&] { std::memcpy(&probe, &probe_data, std::min<size_t>(probe_char->attr_value.attr_len, sizeof(probe))); });
+
+    auto input = Input::instance();
+    if (input->available() < 2) {
+        return ESP_GATT_BUSY;
+    }
+    ProbeSlot& slot = probe_slots[probe.id % probe_slots.size()];
+    slot.rx_us.store(rx_us, std::memory_order_relaxed);
+    slot.conn_id.store(caller_conn_id(), std::memory_order_relaxed);
+    slot.id.store(probe.id, std::memory_order_release);
+
+    if (probe.x || probe.y) {
+        input->submit({.type = Input::Command::MOVE, .x = probe.x, .y = probe.y});
+    }
+    return input->submit({.type = Input::Command::PROBE, .x = static_cast<int32_t>(probe.id)}) ? ESP_GATT_OK : ESP_GATT_BUSY;
+}
+
+void Event::probe_done(uint32_t id, int64_t dequeue_us, int64_t emit_us) {
+    auto self = instance();
+    const ProbeSlot& slot = self->probe_slots[id % self->probe_slots.size()];
+    if (slot.id.load(std::memory_order_acquire) != id) {
+        // 已被后来的探针覆盖
+        return;
+    }
+    const int64_t rx_us = slot.rx_us.load(std::memory_order_relaxed);
+    const uint16_t conn_id = slot.conn_id.load(std::memory_order_relaxed);
+
+    self->queue_latency.add(static_cast<uint32_t>(dequeue_us - rx_us));
+    self->emit_latency.add(static_cast<uint32_t>(emit_us - dequeue_us));
+    self->total_latency.add(static_cast<uint32_t>(emit_us - rx_us));
+
+    update(latency_char, [&] {
+        const auto queue = self->queue_latency.snapshot();
+        const auto emit = self->emit_latency.snapshot();
+        const auto total = self->total_latency.snapshot();
+        std::memcpy(self->latency_data.queue, queue.data(), sizeof(self->latency_data.queue));
+        std::memcpy(self->latency_data.emit, emit.data(), sizeof(self->latency_data.emit));
+        std::memcpy(self->latency_data.total, total.data(), sizeof(self->latency_data.total));
+    });
+    update(probe_result_char, [&] { self->probe_result = {id, rx_us, dequeue_us, emit_us}; });
+    self->send(app_, probe_result_char, conn_id);
+}
+
+auto Event::get_latency() const -> Latency {
+    const auto total = total_latency.snapshot();
+    uint32_t samples = 0;
+    for (const uint32_t c : total) {
+        samples += c;
+    }
+    return {
+            samples,
+            queue_latency.percentile(0.5),
+            queue_latency.percentile(0.99),
+            queue_latency.percentile(0.999),
+            emit_latency.percentile(0.5),
+            emit_latency.percentile(0.99),
+            emit_latency.percentile(0.999),
+            total_latency.percentile(0.5),
+            total_latency.percentile(0.99),
+            total_latency.percentile(0.999),
+    };
 }
@@ -2,6 +2,8 @@
 #include "../BLE.hpp"
 #include "../Features.hpp"
 #include "../HID/HID.hpp"
+#include "../Input/Input.hpp"
+#include "../../histogram.hpp"
 #include "config/Config.h"
 #include "esp_log.h"
 
@@ -12,58 +14,310 @@ public:
 
     enum { CLICK, MOVE, WHEEL };
 
+    // 命令末尾可选带 uint16_t 序号，按写入长度判断是否存在，用于无响应写入时的丢包统计
     struct CLICK_Data {
         uint16_t button = 0;
-    };
+        uint16_t seq;
+    } __attribute__((packed));
     CLICK_Data click_data;
 
     struct MOVE_Data {
         int x;
         int y;
-    };
+        uint16_t seq;
+    } __attribute__((packed));
     MOVE_Data move_data;
 
     struct WHEEL_Data {
         uint8_t wheel;
-    };
+        uint16_t seq;
+    } __attribute__((packed));
     WHEEL_Data wheel_data;
 
+    // 高精度相对位移，Q8 定点(1/256 像素)
+    struct MOVE_FINE_Data {
+        int32_t x;
+        int32_t y;
+        uint16_t seq;
+    } __attribute__((packed));
+    MOVE_FINE_Data move_fine_data;
+
+    // 绝对坐标，0..HID::absolute_max 映射到整个屏幕
+    struct MOVE_TO_Data {
+        uint16_t x;
+        uint16_t y;
+        uint16_t seq;
+    } __attribute__((packed));
+    MOVE_TO_Data move_to_data;
+
+    enum : uint8_t { TEXT_UTF8 = 0x00, TEXT_KEYCODES = 0x01, TEXT_SEQ = 0x80 };
+
+    // 文本输入：mode 为 TEXT_UTF8 时 data 为 UTF-8 文本(仅 ASCII 可输入，其余计为无法映射)，
+    // 为 TEXT_KEYCODES 时 data 为 (修饰键, 用法码) 对；含 TEXT_SEQ 时末尾跟 uint16_t 序号
+    struct TEXT_Data {
+        uint8_t mode;
+        uint8_t data[ESP_GATT_MAX_ATTR_LEN - 1];
+    } __attribute__((packed));
+    TEXT_Data text_data;
+
+    // 时间同步：主机写入 t1，设备记录收到时刻 t2 与回发时刻 t3 后通知回主机
+    struct TIME_Data {
+        int64_t t1;
+        int64_t t2;
+        int64_t t3;
+    } __attribute__((packed));
+    TIME_Data time_data{};
+
+    enum : uint8_t { BUTTON_PRESS = 0x00, BUTTON_RELEASE = 0x01 };
+
+    // 按住/抬起，button 为按键掩码
+    struct BUTTON_Data {
+        uint8_t action;
+        uint8_t button;
+        uint16_t seq;
+    } __attribute__((packed));
+    BUTTON_Data button_data;
+
+    // 延迟探针：主机写入 id，x/y 不为 0 时探针前先提交一次位移，保证之后有一帧报告
+    struct PROBE_Data {
+        uint32_t id;
+        int16_t x;
+        int16_t y;
+    } __attribute__((packed));
+    PROBE_Data probe_data;
+
+    // 探针结果，设备 esp_timer 时钟(µs)，通过 0xEF0D 通知回写入探针的连接
+    struct PROBE_Result {
+        uint32_t id;
+        int64_t rx_us;       // 写入到达 GATTS 回调
+        int64_t dequeue_us;  // 输入任务取出探针
+        int64_t emit_us;     // 探针之后第一帧 HID 报告交给协议栈
+    } __attribute__((packed));
+    PROBE_Result probe_result{};
+
+    static constexpr size_t latency_buckets = 24;
+
+    // 各阶段延迟的对数分桶计数(µs)，第 i 桶为 [2^(i-1), 2^i)，通过 0xEF0E 读取
+    struct LATENCY_Data {
+        uint32_t queue[latency_buckets];  // rx → dequeue
+        uint32_t emit[latency_buckets];   // dequeue → emit
+        uint32_t total[latency_buckets];  // rx → emit
+    } __attribute__((packed));
+    LATENCY_Data latency_data{};
+
+    struct Latency {
+        uint32_t samples;
+        uint32_t queue_p50, queue_p99, queue_p999;
+        uint32_t emit_p50, emit_p99, emit_p999;
+        uint32_t total_p50, total_p99, total_p999;
+    };
+
+    /// 按直方图估计的各阶段分位数(µs，桶上界)
+    auto get_latency() const -> Latency;
+
+    // 序号统计，每个连接各自统计，通过 0xEF05 只通知/返回给该连接自己的计数
+    struct STATS_Data {
+        uint32_t received;  // 带序号的命令数
+        uint32_t lost;      // 按跳号推算的丢失条数
+        uint32_t gaps;      // 跳号次数
+        uint32_t stale;     // 重复或乱序的序号
+        uint32_t busy;      // 输入队列满被拒绝的命令数
+        uint16_t last_seq;
+        uint32_t timed;          // 已执行的定时命令数
+        uint32_t timed_late;     // 超过迟到阈值的定时命令数
+        uint32_t timed_dropped;  // 定时堆已满被丢弃的命令数
+        uint32_t max_late_us;
+        uint32_t avg_late_us;
+        uint32_t keys;             // 已发出的按键数
+        uint32_t keys_per_second;  // 最近一秒的按键速率
+        uint32_t text_unmapped;    // 无法映射到按键的字符数
+    } __attribute__((packed));
+    STATS_Data stats_data{};
+
+    enum : uint8_t { BATCH_DELAY = 0x01, BATCH_SEQ = 0x02 };
+
+    // 批量输入样本，button 为本样本要点击的按键
+    struct BATCH_Sample {
+        int16_t x;
+        int16_t y;
+        int8_t wheel;
+        uint8_t button;
+    } __attribute__((packed));
+
+    // flags 含 BATCH_DELAY 时每个样本后跟 uint16_t 延时(µs)，表示执行完本样本后等待多久再执行下一个；
+    // 含 BATCH_SEQ 时全部样本之后跟 uint16_t 序号，整批算一条命令
+    struct BATCH_Data {
+        uint8_t count;
+        uint8_t flags;
+        uint8_t samples[ESP_GATT_MAX_ATTR_LEN - 2];
+    } __attribute__((packed));
+    BATCH_Data batch_data;
+
+    // 定时命令，at_us 为设备 esp_timer 时钟下的执行时刻
+    struct TIMED_Entry {
+        int64_t at_us;
+        int16_t x;
+        int16_t y;
+        int8_t wheel;
+        uint8_t button;
+    } __attribute__((packed));
+
+    // 布局同 BATCH_Data，flags 仅支持 BATCH_SEQ
+    using TIMED_Data = BATCH_Data;
+    TIMED_Data timed_data;
+
     auto registrator() -> void override;
 
     BLE_MSG_BEGIN;
-    register_char(
-            _profile, click_data, BLE_MSG(click_event), 0xEF01, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
-    register_char(
-            _profile, move_data, BLE_MSG(move_event), 0xEF02, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
-    register_char(
-            _profile, wheel_data, BLE_MSG(wheel_event), 0xEF03, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
+    click_char = register_char(_profile,
+                               click_data,
+                               BLE_MSG(click_event),
+                               0xEF01,
+                               ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                               ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
+    move_char = register_char(_profile,
+                              move_data,
+                              BLE_MSG(move_event),
+                              0xEF02,
+                              ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                              ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
+    wheel_char = register_char(_profile,
+                               wheel_data,
+                               BLE_MSG(wheel_event),
+                               0xEF03,
+                               ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                               ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
+    batch_char = register_char(_profile, batch_data, BLE_MSG(batch_event), 0xEF04, ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR);
+    timed_char = register_char(_profile, timed_data, BLE_MSG(timed_event), 0xEF06, ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR);
+    stats_char = register_char(_profile, stats_data, BLE_MSG(stats_read), 0xEF05, ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
+    stats_char->priority = Priority::TELEMETRY;
+    stats_char->skip_unchanged = true;
+    stats_descr = register_descr(_profile, stats_char, stats_ccc, nullptr, ESP_GATT_UUID_CHAR_CLIENT_CONFIG, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
+    move_to_char = register_char(_profile, move_to_data, BLE_MSG(move_to_event), 0xEF08, ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR);
+    move_fine_char = register_char(_profile, move_fine_data, BLE_MSG(move_fine_event), 0xEF09, ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR);
+    button_char = register_char(_profile, button_data, BLE_MSG(button_event), 0xEF0B, ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR);
+    text_char = register_char(_profile, text_data, BLE_MSG(text_event), 0xEF0A, ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR);
+    time_char = register_char(_profile,
+                              time_data,
+                              BLE_MSG(time_event),
+                              0xEF07,
+                              ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                              ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
+    time_char->stamp_offset = offsetof(TIME_Data, t3);
+    time_descr = register_descr(_profile, time_char, time_ccc, nullptr, ESP_GATT_UUID_CHAR_CLIENT_CONFIG, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
+    probe_char = register_char(_profile, probe_data, BLE_MSG(probe_event), 0xEF0C, ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR);
+    probe_result_char = register_char(_profile, probe_result, nullptr, 0xEF0D, ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
+    register_descr(_profile, probe_result_char, probe_ccc, nullptr, ESP_GATT_UUID_CHAR_CLIENT_CONFIG, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
+    latency_char = register_char(_profile, latency_data, nullptr, 0xEF0E, ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ);
     BLE_MSG_END;
 
     BLE_MSG_FUNC(click_event) {
-        HID::instance()->click(click_data.button);
-        return ESP_GATT_OK;
+        const bool ok = Input::instance()->submit({.type = Input::Command::CLICK, .button = static_cast<uint8_t>(click_data.button)});
+        track(click_char, sizeof(click_data), click_data.seq, ok);
+        return ok ? ESP_GATT_OK : ESP_GATT_BUSY;
     }
 
     BLE_MSG_FUNC(move_event) {
-        while (move_data.x != 0 || move_data.y != 0) {
-            int8_t step_x = static_cast<int8_t>(std::clamp<int32_t>(move_data.x, -128, 127));
-            int8_t step_y = static_cast<int8_t>(std::clamp<int32_t>(move_data.y, -128, 127));
+        const bool ok = Input::instance()->submit({.type = Input::Command::MOVE, .x = move_data.x, .y = move_data.y});
+        track(move_char, sizeof(move_data), move_data.seq, ok);
+        return ok ? ESP_GATT_OK : ESP_GATT_BUSY;
+    }
 
-            const uint8_t ux = *reinterpret_cast<uint8_t*>(&step_x);
-            const uint8_t uy = *reinterpret_cast<uint8_t*>(&step_y);
+    BLE_MSG_FUNC(wheel_event) {
+        const bool ok = Input::instance()->submit({.type = Input::Command::WHEEL, .wheel = static_cast<int8_t>(wheel_data.wheel)});
+        track(wheel_char, sizeof(wheel_data), wheel_data.seq, ok);
+        return ok ? ESP_GATT_OK : ESP_GATT_BUSY;
+    }
 
-            HID::instance()->move(ux, uy);
+    BLE_MSG_FUNC(move_to_event) {
+        const bool ok = Input::instance()->submit({.type = Input::Command::MOVE_TO, .x = move_to_data.x, .y = move_to_data.y});
+        track(move_to_char, sizeof(move_to_data), move_to_data.seq, ok);
+        return ok ? ESP_GATT_OK : ESP_GATT_BUSY;
+    }
 
-            move_data.x -= step_x;
-            move_data.y -= step_y;
-        }
-        return ESP_GATT_OK;
+    BLE_MSG_FUNC(move_fine_event) {
+        const bool ok = Input::instance()->submit({.type = Input::Command::MOVE_FINE, .x = move_fine_data.x, .y = move_fine_data.y});
+        track(move_fine_char, sizeof(move_fine_data), move_fine_data.seq, ok);
+        return ok ? ESP_GATT_OK : ESP_GATT_BUSY;
     }
 
-    BLE_MSG_FUNC(wheel_event) {
-        HID::instance()->wheel(wheel_data.wheel);
-        return ESP_GATT_OK;
+    BLE_MSG_FUNC(button_event) {
+        if (button_data.action != BUTTON_PRESS && button_data.action != BUTTON_RELEASE) {
+            return ESP_GATT_ILLEGAL_PARAMETER;
+        }
+        const auto type = button_data.action == BUTTON_PRESS ? Input::Command::PRESS : Input::Command::RELEASE;
+        const bool ok = Input::instance()->submit({.type = type, .button = button_data.button});
+        track(button_char, sizeof(button_data), button_data.seq, ok);
+        return ok ? ESP_GATT_OK : ESP_GATT_BUSY;
     }
 
+    BLE_MSG_FUNC(batch_event);
+    BLE_MSG_FUNC(timed_event);
+    BLE_MSG_FUNC(time_event);
+    BLE_MSG_FUNC(text_event);
+    BLE_MSG_FUNC(probe_event);
+    BLE_MSG_FUNC(stats_read);
+
 private:
+    struct CCCD {
+        uint8_t info[2]{
+                0x00,
+                0x00,
+        };
+    };
+    CCCD stats_ccc;
+    CCCD time_ccc;
+    CCCD probe_ccc;
+
+    // 每个连接槽的序号状态与计数，只在 BTC 任务中访问；槽位代数变化说明换了连接，从头统计
+    struct PeerStats {
+        uint32_t generation;
+        bool seq_synced;
+        STATS_Data stats;
+    };
+    std::array<PeerStats, max_connections> peer_stats{};
+
+    // 已收到、尚未完成的探针，按 id 取模存放，写者为 BTC 任务，读者为输入任务
+    struct ProbeSlot {
+        std::atomic<uint32_t> id;
+        std::atomic<int64_t> rx_us;
+        std::atomic<uint16_t> conn_id;
+    };
+    std::array<ProbeSlot, 16> probe_slots{};
+    Histogram<latency_buckets> queue_latency;
+    Histogram<latency_buckets> emit_latency;
+    Histogram<latency_buckets> total_latency;
+
+    inline static std::shared_ptr<CHAR_Profile> click_char;
+    inline static std::shared_ptr<CHAR_Profile> move_char;
+    inline static std::shared_ptr<CHAR_Profile> wheel_char;
+    inline static std::shared_ptr<CHAR_Profile> move_to_char;
+    inline static std::shared_ptr<CHAR_Profile> move_fine_char;
+    inline static std::shared_ptr<CHAR_Profile> text_char;
+    inline static std::shared_ptr<CHAR_Profile> button_char;
+    inline static std::shared_ptr<CHAR_Profile> batch_char;
+    inline static std::shared_ptr<CHAR_Profile> timed_char;
+    inline static std::shared_ptr<CHAR_Profile> stats_char;
+    inline static std::shared_ptr<DESCR_Profile> stats_descr;
+    inline static std::shared_ptr<CHAR_Profile> time_char;
+    inline static std::shared_ptr<DESCR_Profile> time_descr;
+    inline static std::shared_ptr<CHAR_Profile> probe_char;
+    inline static std::shared_ptr<CHAR_Profile> probe_result_char;
+    inline static std::shared_ptr<CHAR_Profile> latency_char;
+
+    /**
+     * @brief 记录一条命令的序号
+     * @param char_ 命令所在特征，写入长度不足 full_len 时视为不带序号
+     * @param accepted 命令是否进入了输入队列
+     */
+    void track(const std::shared_ptr<CHAR_Profile>& char_, size_t full_len, uint16_t seq, bool accepted);
+    void record(uint16_t seq, bool accepted);
+    /// 当前读写事件所属连接的统计，连接不在表中时返回 nullptr
+    auto caller_stats() -> PeerStats*;
+    /// 同步输入引擎的定时与按键统计后放入 stats_data
+    void load_stats(PeerStats& peer);
+    /// 只把该连接的统计通知给它自己
+    void report(PeerStats& peer);
+    /// 输入任务完成探针后回调：记录直方图并通知结果
+    static void probe_done(uint32_t id, int64_t dequeue_us, int64_t emit_us);
 };
@@ -0,0 +1,48 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <stdint.h>
+#include <stdlib.h>
+#include "sdkconfig.h"
+
+/**
+ * @brief 指针加速曲线
+ *
+ * 增益只取决于单条命令的位移大小，编译期按 Kconfig 生成查找表，运行时一次查表一次乘法。
+ * 位移与增益都是 Q8 定点数。关闭 CONFIG_MOTION_ACCEL 时表内全部为 1.0。
+ */
+namespace accel {
+    constexpr int32_t fraction_bits = 8;
+    constexpr int32_t unity = 1 << fraction_bits;
+    constexpr size_t table_size = 128;
+
+    constexpr auto table = [] {
+        std::array<uint16_t, table_size> t{};
+        for (size_t v = 0; v < table_size; ++v) {
+#if CONFIG_MOTION_ACCEL
+            // 阈值以下不加速，到饱和点按 smoothstep 平滑升到最大增益
+            constexpr double low = CONFIG_MOTION_ACCEL_THRESHOLD;
+            constexpr double high = std::max(CONFIG_MOTION_ACCEL_SATURATION, CONFIG_MOTION_ACCEL_THRESHOLD + 1);
+            const double x = std::clamp((static_cast<double>(v) - low) / (high - low), 0.0, 1.0);
+            const double s = x * x * (3 - 2 * x);
+            t[v] = static_cast<uint16_t>(unity * (1.0 + CONFIG_MOTION_ACCEL_GAIN_PERCENT / 100.0 * s) + 0.5);
+#else
+            t[v] = unity;
+#endif
+        }
+        return t;
+    }();
+
+    /// 按位移大小查表缩放一对 Q8 位移，速度用 max + min/2 近似欧氏长度
+    inline auto apply(int32_t& x, int32_t& y) -> void {
+#if CONFIG_MOTION_ACCEL
+        const int32_t ax = abs(x) >> fraction_bits;
+        const int32_t ay = abs(y) >> fraction_bits;
+        const int32_t speed = std::max(ax, ay) + std::min(ax, ay) / 2;
+        const int64_t gain = table[std::min<size_t>(speed, table_size - 1)];
+        // 增益大于 1 时大位移可能超出 int32，截断到可表示范围
+        x = static_cast<int32_t>(std::clamp<int64_t>(x * gain / unity, INT32_MIN, INT32_MAX));
+        y = static_cast<int32_t>(std::clamp<int64_t>(y * gain / unity, INT32_MIN, INT32_MAX));
+#endif
+    }
+} // namespace accel
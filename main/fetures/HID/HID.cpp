@@ -1,4 +1,5 @@
 #include "HID.hpp"
+#include "../Input/Input.hpp"
 #include <algorithm>
 #include <cmath>
 #include <numbers>
@@ -16,24 +17,130 @@ void HID::registrator() {
 }
 
 void HID::click(uint8_t button) {
-    std::this_thread::sleep_for(1ms);
-    mouse_report.button |= button;
-    send(app_, mouse_report_char);
-    mouse_report.button = 0;
-    send(app_, mouse_report_char);
+    mixer_.click(button);
+    Input::instance()->wake();
 }
 
-void HID::move(int8_t x, int8_t y) {
-    std::this_thread::sleep_for(1ms);
-    mouse_report.x = x;
-    mouse_report.y = y;
-    send(app_, mouse_report_char);
-    mouse_report.x = 0;
-    mouse_report.y = 0;
+void HID::press(uint8_t button) {
+    mixer_.press(button);
+    Input::instance()->wake();
+}
+
+void HID::release(uint8_t button) {
+    mixer_.release(button);
+    Input::instance()->wake();
+}
+
+void HID::move(int32_t x, int32_t y) {
+    mixer_.add(x, y, 0);
+    Input::instance()->wake();
+}
+
+void HID::move_fine(int32_t x, int32_t y) {
+    mixer_.add_fine(x, y);
+    Input::instance()->wake();
+}
+
+void HID::wheel(int32_t v) {
+    mixer_.add(0, 0, v);
+    Input::instance()->wake();
+}
+
+void HID::move_to(uint16_t x, uint16_t y) {
+    x = std::min(x, absolute_max);
+    y = std::min(y, absolute_max);
+    abs_target_.store(abs_pending | uint64_t(y) << 16 | x, std::memory_order_release);
+    Input::instance()->wake();
+}
+
+auto HID::reserve_keys(size_t n) -> bool {
+    uint32_t reserved = keys_reserved_.load(std::memory_order_relaxed);
+    do {
+        if (reserved + n > keys_.size()) {
+            return false;
+        }
+    } while (!keys_reserved_.compare_exchange_weak(reserved, reserved + n, std::memory_order_relaxed));
+    return true;
 }
-void HID::wheel(int8_t v) {
-    std::this_thread::sleep_for(1ms);
-    mouse_report.wheel = v;
+
+void HID::release_keys(size_t n) {
+    keys_reserved_.fetch_sub(n, std::memory_order_relaxed);
+}
+
+auto HID::key(uint8_t usage, uint8_t modifier) -> bool {
+    if (key_full_ || usage == 0) {
+        release_keys(1);
+        return false;
+    }
+    keys_[key_tail_++] = {usage, modifier};
+    key_full_ = key_tail_ == key_head_;
+    return true;
+}
+
+auto HID::pending() const -> bool {
+    return (abs_target_.load(std::memory_order_relaxed) & abs_pending) || mixer_.pending() || keys_down_ || key_full_ || key_head_ != key_tail_;
+}
+
+void HID::flush_keyboard() {
+    // 一帧里尽量多按下互不相同的键：修饰键相同、不与当前仍按住的键重复，最多 6 个；
+    // 凑不出新键时先全部抬起，下一帧再按
+    KeyBrdReport next;
+    uint8_t count = 0;
+    const KeyBrdReport& held = keybrd_report;
+    const uint8_t modifier = keys_down_ ? held.modifier : keys_[key_head_].modifier;
+
+    auto contains = [](const uint8_t* codes, uint8_t n, uint8_t usage) { return std::find(codes, codes + n, usage) != codes + n; };
+    while ((key_full_ || key_head_ != key_tail_) && count < std::size(next.keycode)) {
+        const keymap::Key& k = keys_[key_head_];
+        if (k.modifier != modifier || contains(next.keycode, count, k.usage) || (keys_down_ && contains(held.keycode, std::size(held.keycode), k.usage))) {
+            break;
+        }
+        next.keycode[count++] = k.usage;
+        ++key_head_;
+        key_full_ = false;
+    }
+    if (count) {
+        next.modifier = modifier;
+    }
+
+    update(keybrd_report_char, [&] { keybrd_report = next; });
+    send(app_, keybrd_report_char);
+    keys_down_ = count != 0;
+    keys_sent_.fetch_add(count, std::memory_order_relaxed);
+    release_keys(count);
+}
+
+auto HID::flush() -> bool {
+    if (keys_down_ || key_full_ || key_head_ != key_tail_) {
+        flush_keyboard();
+    }
+
+    // 绝对坐标先于相对位移发出，之后的相对位移以新位置为起点
+    const uint64_t target = abs_target_.exchange(0, std::memory_order_acq_rel);
+    if (target & abs_pending) {
+        update(abs_report_char, [&] {
+            abs_report.x = target & 0xFFFF;
+            abs_report.y = target >> 16 & 0xFFFF;
+        });
+        send(app_, abs_report_char);
+    }
+    if (!mixer_.pending()) {
+        return pending();
+    }
+
+    const Mixer::Frame frame = mixer_.take();
+    MouseReport report;
+    report.button = frame.button;
+    report.x = static_cast<decltype(report.x)>(frame.x);
+    report.y = static_cast<decltype(report.y)>(frame.y);
+    report.wheel = static_cast<int8_t>(frame.wheel);
+
+    update(mouse_report_char, [&] { mouse_report = report; });
     send(app_, mouse_report_char);
-    mouse_report.wheel = 0;
+    update(mouse_report_char, [&] {
+        mouse_report.x = 0;
+        mouse_report.y = 0;
+        mouse_report.wheel = 0;
+    });
+    return pending();
 }
@@ -1,6 +1,10 @@
 #pragma once
+#include <limits>
 #include "../BLE.hpp"
 #include "../Features.hpp"
+#include "Keymap.hpp"
+#include "Mixer.hpp"
+#include "ReportMap.hpp"
 #include "config/Config.h"
 #include "esp_log.h"
 
@@ -9,62 +13,146 @@ public:
     HID();
     ~HID();
 
+    // 以下只提交到混合器，不阻塞也不直接发送，任意线程可调用
     void click(uint8_t button);
-    void move(int8_t x, int8_t y);
-    void wheel(int8_t vertical);
+    /// 按住/抬起按键，只有按键状态变化时才发送报告，可用于拖拽
+    void press(uint8_t button);
+    void release(uint8_t button);
+    void move(int32_t x, int32_t y);
+    void wheel(int32_t vertical);
+    /// 提交 Q8 定点位移(1/256 像素)，小数部分在混合器中累积
+    void move_fine(int32_t x, int32_t y);
+    /// 设置绝对坐标(0..absolute_max)，下一帧发送，未发出前的多次设置只保留最新一次
+    void move_to(uint16_t x, uint16_t y);
+
+    /**
+     * @brief 排入一次按键(按下后由后续报告抬起)，仅由输入任务调用
+     * @return 键盘缓冲区已满时返回 false
+     */
+    auto key(uint8_t usage, uint8_t modifier) -> bool;
+    /**
+     * @brief 为即将投递的 n 个按键预留键盘缓冲区，任意任务可调用
+     *
+     * 预留从投递一直持续到按键发出，仍在输入队列里的 KEY 命令也占着位置，
+     * 预留成功的按键到达 key() 时缓冲区一定放得下。
+     * @return 剩余空间不足时返回 false，不做任何预留
+     */
+    auto reserve_keys(size_t n) -> bool;
+    /// 归还没有投递出去的预留
+    void release_keys(size_t n);
+    /// 已发出的按键数
+    auto keys_sent() const -> uint32_t {
+        return keys_sent_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 从混合器取出一帧鼠标报告并发送，仅由输入任务调用，每个连接事件最多一次
+     * @return 发送后是否仍有待发内容（剩余位移或未发出的点击）
+     */
+    auto flush() -> bool;
+    auto pending() const -> bool;
+    /// 订阅报告的连接是否全部拥塞，是则暂缓取帧，让位移留在混合器里合并
+    auto backlogged() const -> bool {
+        return BLEBase::backlogged({mouse_report_char->char_handle, abs_report_char->char_handle, keybrd_report_char->char_handle});
+    }
+
+    static constexpr auto report_descriptor = std::to_array<uint8_t>({
+            0x05, 0x01, // USAGE_PAGE (Generic Desktop)
+            0x09, 0x06, // USAGE (Keyboard)
+            0xa1, 0x01, // COLLECTION (Application)
+            0x85, 0x01, //   REPORT_ID (1)
+            0x05, 0x07, //   USAGE_PAGE (Keyboard)
+            0x19, 0xe0, //   USAGE_MINIMUM (Keyboard LeftControl)
+            0x29, 0xe7, //   USAGE_MAXIMUM (Keyboard Right GUI)
+            0x15, 0x00, //   LOGICAL_MINIMUM (0)
+            0x25, 0x01, //   LOGICAL_MAXIMUM (1)
+            0x75, 0x01, //   REPORT_SIZE (1)
+            0x95, 0x08, //   REPORT_COUNT (8)
+            0x81, 0x02, //   INPUT (Data,Var,Abs)
+            0x95, 0x06, //   REPORT_COUNT (6)
+            0x75, 0x08, //   REPORT_SIZE (8)
+            0x15, 0x00, //   LOGICAL_MINIMUM (0)
+            0x25, 0x65, //   LOGICAL_MAXIMUM (101)
+            0x05, 0x07, //   USAGE_PAGE (Keyboard)
+            0x19, 0x00, //   USAGE_MINIMUM (Reserved (no event indicated))
+            0x29, 0x65, //   USAGE_MAXIMUM (Keyboard Application)
+            0x81, 0x00, //   INPUT (Data,Ary,Abs)
+            0xc0, // END_COLLECTION
+            0x05, 0x01, // USAGE_PAGE (Generic Desktop)
+            0x09, 0x02, // USAGE (Mouse)
+            0xa1, 0x01, // COLLECTION (Application)
+            0x85, 0x02, //   REPORT_ID (2)
+            0x09, 0x01, //   USAGE (Pointer)
+            0xa1, 0x00, //   COLLECTION (Physical)
+            0x05, 0x09, //     USAGE_PAGE (Button)
+            0x19, 0x01, //     USAGE_MINIMUM (Button 1)
+            0x29, 0x03, //     USAGE_MAXIMUM (Button 3)
+            0x15, 0x00, //     LOGICAL_MINIMUM (0)
+            0x25, 0x01, //     LOGICAL_MAXIMUM (1)
+            0x95, 0x03, //     REPORT_COUNT (3)
+            0x75, 0x01, //     REPORT_SIZE (1)
+            0x81, 0x02, //     INPUT (Data,Var,Abs)
+            0x95, 0x01, //     REPORT_COUNT (1)
+            0x75, 0x05, //     REPORT_SIZE (5)
+            0x81, 0x03, //     INPUT (Cnst,Var,Abs)
+            0x05, 0x01, //     USAGE_PAGE (Generic Desktop)
+#if CONFIG_HID_MOUSE_AXIS_16BIT
+            0x09, 0x30, //     USAGE (X)
+            0x09, 0x31, //     USAGE (Y)
+            0x16, 0x01, 0x80, //     LOGICAL_MINIMUM (-32767)
+            0x26, 0xff, 0x7f, //     LOGICAL_MAXIMUM (32767)
+            0x75, 0x10, //     REPORT_SIZE (16)
+            0x95, 0x02, //     REPORT_COUNT (2)
+            0x81, 0x06, //     INPUT (Data,Var,Rel)
+            0x09, 0x38, //     USAGE (Wheel)
+            0x15, 0x81, //     LOGICAL_MINIMUM (-127)
+            0x25, 0x7f, //     LOGICAL_MAXIMUM (127)
+            0x75, 0x08, //     REPORT_SIZE (8)
+            0x95, 0x01, //     REPORT_COUNT (1)
+            0x81, 0x06, //     INPUT (Data,Var,Rel)
+#else
+            0x09, 0x30, //     USAGE (X)
+            0x09, 0x31, //     USAGE (Y)
+            0x09, 0x38, //     USAGE (Wheel)
+            0x15, 0x81, //     LOGICAL_MINIMUM (-127)
+            0x25, 0x7f, //     LOGICAL_MAXIMUM (127)
+            0x75, 0x08, //     REPORT_SIZE (8)
+            0x95, 0x03, //     REPORT_COUNT (3)
+            0x81, 0x06, //     INPUT (Data,Var,Rel)
+#endif
+            0xc0, //   END_COLLECTION
+            0xc0, // END_COLLECTION
+            0x05, 0x01, // USAGE_PAGE (Generic Desktop)
+            0x09, 0x02, // USAGE (Mouse)
+            0xa1, 0x01, // COLLECTION (Application)
+            0x85, 0x03, //   REPORT_ID (3)
+            0x09, 0x01, //   USAGE (Pointer)
+            0xa1, 0x00, //   COLLECTION (Physical)
+            0x05, 0x09, //     USAGE_PAGE (Button)
+            0x19, 0x01, //     USAGE_MINIMUM (Button 1)
+            0x29, 0x03, //     USAGE_MAXIMUM (Button 3)
+            0x15, 0x00, //     LOGICAL_MINIMUM (0)
+            0x25, 0x01, //     LOGICAL_MAXIMUM (1)
+            0x95, 0x03, //     REPORT_COUNT (3)
+            0x75, 0x01, //     REPORT_SIZE (1)
+            0x81, 0x02, //     INPUT (Data,Var,Abs)
+            0x95, 0x01, //     REPORT_COUNT (1)
+            0x75, 0x05, //     REPORT_SIZE (5)
+            0x81, 0x03, //     INPUT (Cnst,Var,Abs)
+            0x05, 0x01, //     USAGE_PAGE (Generic Desktop)
+            0x09, 0x30, //     USAGE (X)
+            0x09, 0x31, //     USAGE (Y)
+            0x15, 0x00, //     LOGICAL_MINIMUM (0)
+            0x26, 0xff, 0x7f, //     LOGICAL_MAXIMUM (32767)
+            0x75, 0x10, //     REPORT_SIZE (16)
+            0x95, 0x02, //     REPORT_COUNT (2)
+            0x81, 0x02, //     INPUT (Data,Var,Abs)
+            0xc0, //   END_COLLECTION
+            0xc0, // END_COLLECTION
+    });
 
     struct Map {
-        std::array<uint8_t, 95> report_map = {
-                0x05, 0x01, // USAGE_PAGE (Generic Desktop)
-                0x09, 0x06, // USAGE (Keyboard)
-                0xa1, 0x01, // COLLECTION (Application)
-                0x85, 0x01, //   REPORT_ID (1)
-                0x05, 0x07, //   USAGE_PAGE (Keyboard)
-                0x19, 0xe0, //   USAGE_MINIMUM (Keyboard LeftControl)
-                0x29, 0xe7, //   USAGE_MAXIMUM (Keyboard Right GUI)
-                0x15, 0x00, //   LOGICAL_MINIMUM (0)
-                0x25, 0x01, //   LOGICAL_MAXIMUM (1)
-                0x75, 0x01, //   REPORT_SIZE (1)
-                0x95, 0x08, //   REPORT_COUNT (8)
-                0x81, 0x02, //   INPUT (Data,Var,Abs)
-                0x95, 0x06, //   REPORT_COUNT (6)
-                0x75, 0x08, //   REPORT_SIZE (8)
-                0x15, 0x00, //   LOGICAL_MINIMUM (0)
-                0x25, 0x65, //   LOGICAL_MAXIMUM (101)
-                0x05, 0x07, //   USAGE_PAGE (Keyboard)
-                0x19, 0x00, //   USAGE_MINIMUM (Reserved (no event indicated))
-                0x29, 0x65, //   USAGE_MAXIMUM (Keyboard Application)
-                0x81, 0x00, //   INPUT (Data,Ary,Abs)
-                0xc0, // END_COLLECTION
-                0x05, 0x01, // USAGE_PAGE (Generic Desktop)
-                0x09, 0x02, // USAGE (Mouse)
-                0xa1, 0x01, // COLLECTION (Application)
-                0x85, 0x02, //   REPORT_ID (2)
-                0x09, 0x01, //   USAGE (Pointer)
-                0xa1, 0x00, //   COLLECTION (Physical)
-                0x05, 0x09, //     USAGE_PAGE (Button)
-                0x19, 0x01, //     USAGE_MINIMUM (Button 1)
-                0x29, 0x03, //     USAGE_MAXIMUM (Button 3)
-                0x15, 0x00, //     LOGICAL_MINIMUM (0)
-                0x25, 0x01, //     LOGICAL_MAXIMUM (1)
-                0x95, 0x03, //     REPORT_COUNT (3)
-                0x75, 0x01, //     REPORT_SIZE (1)
-                0x81, 0x02, //     INPUT (Data,Var,Abs)
-                0x95, 0x01, //     REPORT_COUNT (1)
-                0x75, 0x05, //     REPORT_SIZE (5)
-                0x81, 0x03, //     INPUT (Cnst,Var,Abs)
-                0x05, 0x01, //     USAGE_PAGE (Generic Desktop)
-                0x09, 0x30, //     USAGE (X)
-                0x09, 0x31, //     USAGE (Y)
-                0x09, 0x38, //     USAGE (Wheel)
-                0x15, 0x81, //     LOGICAL_MINIMUM (-127)
-                0x25, 0x7f, //     LOGICAL_MAXIMUM (127)
-                0x75, 0x08, //     REPORT_SIZE (8)
-                0x95, 0x03, //     REPORT_COUNT (3)
-                0x81, 0x06, //     INPUT (Data,Var,Rel)
-                0xc0, //   END_COLLECTION
-                0xc0, // END_COLLECTION
-        };
+        std::remove_const_t<decltype(report_descriptor)> report_map = report_descriptor;
     };
     Map map;
 
@@ -80,6 +168,7 @@ public:
         };
     };
     HID_REF mouse_ref;
+    HID_REF abs_ref;
     HID_REF keybrd_ref;
     
     struct CCCD {
@@ -89,45 +178,76 @@ public:
         };
     };
     CCCD mouse_cccd;
+    CCCD abs_cccd;
     CCCD keybrd_cccd;
 
     struct MouseReport {
         uint8_t button = 0;
+#if CONFIG_HID_MOUSE_AXIS_16BIT
+        int16_t x = 0;
+        int16_t y = 0;
+#else
         int8_t x = 0;
         int8_t y = 0;
+#endif
         int8_t wheel = 0;
     } __attribute__((packed));
     MouseReport mouse_report;
 
     struct KeyBrdReport {
-        uint8_t modifier;
-        uint8_t keycode[6];
+        uint8_t modifier = 0;
+        uint8_t keycode[6]{};
     } __attribute__((packed));
     KeyBrdReport keybrd_report;
 
+    // 绝对坐标，0..absolute_max 映射到整个屏幕
+    struct AbsReport {
+        uint8_t button = 0;
+        uint16_t x = 0;
+        uint16_t y = 0;
+    } __attribute__((packed));
+    AbsReport abs_report;
+
+    static constexpr uint16_t absolute_max = 32767;
+
+    static_assert(report_map::matches<MouseReport>(report_descriptor, 0x02), "鼠标报告描述符与 MouseReport 布局不一致");
+    static_assert(report_map::matches<KeyBrdReport>(report_descriptor, 0x01), "键盘报告描述符与 KeyBrdReport 布局不一致");
+    static_assert(report_map::matches<AbsReport>(report_descriptor, 0x03), "绝对坐标报告描述符与 AbsReport 布局不一致");
+    static_assert(Mixer::axis_limit <= std::numeric_limits<decltype(MouseReport::x)>::max(), "混合器位移上限超出报告范围");
+
     uint8_t protocol_mode = 1;
     uint8_t control_point = 0;
 
     inline static std::shared_ptr<CHAR_Profile> mouse_report_char;
     inline static std::shared_ptr<CHAR_Profile> keybrd_report_char;
+    inline static std::shared_ptr<CHAR_Profile> abs_report_char;
 
     BLE_MSG_BEGIN;
     register_char(_profile, hid_info, nullptr, ESP_GATT_UUID_HID_INFORMATION, ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ);
     register_char(_profile, map, nullptr, ESP_GATT_UUID_HID_REPORT_MAP, ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ);
     register_char(_profile, protocol_mode, nullptr, ESP_GATT_UUID_HID_PROTO_MODE, ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE_NR);
 
-    // keybrd_ref.info[0] = 0x01;
-    // keybrd_ref.info[1] = 0x01;
-    // keybrd_report_char = register_char(_profile, keybrd_report, nullptr, ESP_GATT_UUID_HID_REPORT, ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
-    // register_descr(_profile, keybrd_report_char, keybrd_cccd, nullptr, ESP_GATT_UUID_CHAR_CLIENT_CONFIG, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
-    // register_descr(_profile, keybrd_report_char, keybrd_ref, nullptr, ESP_GATT_UUID_RPT_REF_DESCR, ESP_GATT_PERM_READ);
+    keybrd_ref.info[0] = 0x01;
+    keybrd_ref.info[1] = 0x01;
+    keybrd_report_char = register_char(_profile, keybrd_report, nullptr, ESP_GATT_UUID_HID_REPORT, ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
+    keybrd_report_char->priority = Priority::INPUT;
+    register_descr(_profile, keybrd_report_char, keybrd_cccd, nullptr, ESP_GATT_UUID_CHAR_CLIENT_CONFIG, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
+    register_descr(_profile, keybrd_report_char, keybrd_ref, nullptr, ESP_GATT_UUID_RPT_REF_DESCR, ESP_GATT_PERM_READ);
 
     mouse_ref.info[0] = 0x02;
     mouse_ref.info[1] = 0x01;
     mouse_report_char = register_char(_profile, mouse_report, nullptr, ESP_GATT_UUID_HID_REPORT, ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
+    mouse_report_char->priority = Priority::INPUT;
     register_descr(_profile, mouse_report_char, mouse_cccd, nullptr, ESP_GATT_UUID_CHAR_CLIENT_CONFIG, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
     register_descr(_profile, mouse_report_char, mouse_ref, nullptr, ESP_GATT_UUID_RPT_REF_DESCR, ESP_GATT_PERM_READ);
 
+    abs_ref.info[0] = 0x03;
+    abs_ref.info[1] = 0x01;
+    abs_report_char = register_char(_profile, abs_report, nullptr, ESP_GATT_UUID_HID_REPORT, ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY);
+    abs_report_char->priority = Priority::INPUT;
+    register_descr(_profile, abs_report_char, abs_cccd, nullptr, ESP_GATT_UUID_CHAR_CLIENT_CONFIG, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
+    register_descr(_profile, abs_report_char, abs_ref, nullptr, ESP_GATT_UUID_RPT_REF_DESCR, ESP_GATT_PERM_READ);
+
     register_char(_profile, control_point, nullptr, ESP_GATT_UUID_HID_CONTROL_POINT, 0, ESP_GATT_CHAR_PROP_BIT_WRITE_NR);
     BLE_MSG_END;
 
@@ -138,4 +258,23 @@ public:
     }
 
 private:
+    Mixer mixer_;
+
+    // 待发按键环形缓冲，仅输入任务访问
+    std::array<keymap::Key, 256> keys_;
+    uint8_t key_head_ = 0;
+    uint8_t key_tail_ = 0;
+    bool key_full_ = false;
+    // 最近一次发出的键盘报告是否有键按住
+    bool keys_down_ = false;
+    std::atomic<uint32_t> keys_sent_{0};
+    // 已预留、尚未发出的按键数，不超过 keys_ 容量
+    std::atomic<uint32_t> keys_reserved_{0};
+
+    /// 发出一帧键盘报告
+    void flush_keyboard();
+    // bit32 置位表示有待发的绝对坐标，低 32 位为 y << 16 | x
+    std::atomic<uint64_t> abs_target_{0};
+
+    static constexpr uint64_t abs_pending = uint64_t(1) << 32;
 };
@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <stdint.h>
+
+/**
+ * @brief ASCII → HID 键盘用法码 + 修饰键，美式布局，编译期生成
+ */
+namespace keymap {
+    struct Key {
+        uint8_t usage = 0;  // 0 表示无法输入
+        uint8_t modifier = 0;
+    };
+
+    constexpr uint8_t left_ctrl = 0x01;
+    constexpr uint8_t left_shift = 0x02;
+    constexpr uint8_t left_alt = 0x04;
+    constexpr uint8_t left_gui = 0x08;
+
+    constexpr auto ascii = [] {
+        std::array<Key, 128> t{};
+        for (uint8_t i = 0; i < 26; ++i) {
+            t['a' + i] = {static_cast<uint8_t>(0x04 + i), 0};
+            t['A' + i] = {static_cast<uint8_t>(0x04 + i), left_shift};
+        }
+        // 1..9 为 0x1E..0x26，0 为 0x27；上档符号与数字同键
+        constexpr char shifted_digits[] = ")!@#$%^&*(";
+        for (uint8_t i = 0; i < 10; ++i) {
+            const uint8_t usage = i == 0 ? 0x27 : 0x1E + i - 1;
+            t['0' + i] = {usage, 0};
+            t[static_cast<uint8_t>(shifted_digits[i])] = {usage, left_shift};
+        }
+
+        struct Pair {
+            char plain;
+            char shifted;
+            uint8_t usage;
+        };
+        constexpr Pair symbols[] = {
+                {'-', '_', 0x2D},
+                {'=', '+', 0x2E},
+                {'[', '{', 0x2F},
+                {']', '}', 0x30},
+                {'\\', '|', 0x31},
+                {';', ':', 0x33},
+                {'\'', '"', 0x34},
+                {'`', '~', 0x35},
+                {',', '<', 0x36},
+                {'.', '>', 0x37},
+                {'/', '?', 0x38},
+        };
+        for (const auto& p : symbols) {
+            t[static_cast<uint8_t>(p.plain)] = {p.usage, 0};
+            t[static_cast<uint8_t>(p.shifted)] = {p.usage, left_shift};
+        }
+
+        t['\n'] = {0x28, 0};
+        t['\b'] = {0x2A, 0};
+        t['\t'] = {0x2B, 0};
+        t[' '] = {0x2C, 0};
+        t[0x1B] = {0x29, 0};
+        return t;
+    }();
+
+    static_assert(ascii['a'].usage == 0x04 && ascii['z'].usage == 0x1D);
+    static_assert(ascii['A'].usage == 0x04 && ascii['A'].modifier == left_shift);
+    static_assert(ascii['1'].usage == 0x1E && ascii['0'].usage == 0x27 && ascii['!'].usage == 0x1E && ascii[')'].usage == 0x27);
+    static_assert(ascii['?'].usage == 0x38 && ascii['?'].modifier == left_shift);
+
+    constexpr auto lookup(uint32_t codepoint) -> Key {
+        return codepoint < ascii.size() ? ascii[codepoint] : Key{};
+    }
+} // namespace keymap
@@ -0,0 +1,153 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <stdint.h>
+#include <stdlib.h>
+#include "sdkconfig.h"
+
+/**
+ * @brief 多生产者无锁鼠标报告混合器
+ *
+ * 任意线程都可以提交位移增量和点击，只有发送者线程调用 take() 取出一帧：
+ * 位移按报告范围饱和，超出的部分留到下一帧；不同按键的点击在同一帧里按位或，
+ * 同一按键的多次点击逐帧展开，不会被合并掉。
+ * press/release 维护按住状态，只有状态变化时才需要发帧；两帧之间按下又抬起的键也至少按下一帧。
+ * X/Y 以 Q8 定点累加，报告只取整数部分，小数余量保留到之后的帧，不会因取整而漂移。
+ */
+class Mixer {
+public:
+    static constexpr uint8_t button_count = 3;
+#if CONFIG_HID_MOUSE_AXIS_16BIT
+    static constexpr int32_t axis_limit = 32767;
+#else
+    static constexpr int32_t axis_limit = 127;
+#endif
+    static constexpr int32_t wheel_limit = 127;
+    static constexpr int32_t fraction_bits = 8;
+    static constexpr int32_t one = 1 << fraction_bits;
+    /// 单次整数位移上限，转为 Q8 后仍在 int32 范围内
+    static constexpr int32_t whole_limit = 1 << 22;
+
+    /// 整数位移转为 Q8，超出 ±whole_limit 的部分截断
+    static constexpr auto to_fine(int32_t _v) -> int32_t {
+        return std::clamp(_v, -whole_limit, whole_limit) * one;
+    }
+
+    struct Frame {
+        uint8_t button;
+        int32_t x;
+        int32_t y;
+        int32_t wheel;
+    };
+
+    void add(int32_t _x, int32_t _y, int32_t _wheel) {
+        add_fine(to_fine(_x), to_fine(_y));
+        if (_wheel) {
+            accumulate(wheel_, _wheel);
+        }
+    }
+
+    /// 提交 Q8 定点位移(1/256 像素)
+    void add_fine(int32_t _x, int32_t _y) {
+        if (_x) {
+            accumulate(x_, _x);
+        }
+        if (_y) {
+            accumulate(y_, _y);
+        }
+    }
+
+    void click(uint8_t _mask) {
+        for (uint8_t i = 0; i < button_count; ++i) {
+            if (_mask & (1 << i)) {
+                clicks_[i].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void press(uint8_t _mask) {
+        // 已按住的键再次按下不算状态变化
+        const uint8_t was = held_.fetch_or(_mask, std::memory_order_relaxed);
+        if (_mask & ~was) {
+            pressed_.fetch_or(_mask & ~was, std::memory_order_release);
+        }
+    }
+
+    void release(uint8_t _mask) {
+        held_.fetch_and(~_mask, std::memory_order_release);
+    }
+
+    /// 是否还有待发内容，仅发送者线程调用
+    [[nodiscard]] auto pending() const -> bool {
+        // 不足一个像素的余量不单独成帧
+        if (sent_ != held_.load(std::memory_order_relaxed) || pressed_.load(std::memory_order_relaxed) || abs(x_.load(std::memory_order_relaxed)) >= one || abs(y_.load(std::memory_order_relaxed)) >= one || wheel_.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        return std::ranges::any_of(clicks_, [](const std::atomic<uint32_t>& n) { return n.load(std::memory_order_relaxed) != 0; });
+    }
+
+    /// 取出一帧，仅发送者线程调用
+    auto take() -> Frame {
+        Frame frame{};
+        const uint8_t held = held_.load(std::memory_order_acquire);
+        if (sent_ & ~held) {
+            // 上一帧按下但已不再按住的键在这一帧抬起
+            frame.button = held;
+        } else {
+            uint8_t down = pressed_.exchange(0, std::memory_order_acq_rel);
+            for (uint8_t i = 0; i < button_count; ++i) {
+                const uint32_t n = clicks_[i].exchange(0, std::memory_order_acq_rel);
+                if (n) {
+                    down |= 1 << i;
+                    if (n > 1) {
+                        clicks_[i].fetch_add(n - 1, std::memory_order_relaxed);
+                    }
+                }
+            }
+            // 已按住的键上的点击没有可见的状态变化
+            frame.button = held | down;
+        }
+        sent_ = frame.button;
+
+        frame.x = drain(x_, axis_limit, fraction_bits);
+        frame.y = drain(y_, axis_limit, fraction_bits);
+        frame.wheel = drain(wheel_, wheel_limit, 0);
+        return frame;
+    }
+
+private:
+    std::atomic<int32_t> x_{0};
+    std::atomic<int32_t> y_{0};
+    std::atomic<int32_t> wheel_{0};
+    // 每个按键的待发点击次数
+    std::array<std::atomic<uint32_t>, button_count> clicks_{};
+    // 当前按住的键
+    std::atomic<uint8_t> held_{0};
+    // 上一帧之后按下过的键，保证按下至少出现在一帧里
+    std::atomic<uint8_t> pressed_{0};
+    // 上一帧发出的按键状态，仅发送者线程访问
+    uint8_t sent_ = 0;
+
+    // 累加器上限：取帧前堆积多条大位移时饱和在这里，不回绕成反方向
+    static constexpr int32_t accumulator_limit = whole_limit * one;
+
+    static auto accumulate(std::atomic<int32_t>& acc, int32_t value) -> void {
+        int32_t current = acc.load(std::memory_order_relaxed);
+        int32_t next;
+        do {
+            next = static_cast<int32_t>(std::clamp<int64_t>(int64_t(current) + value, -accumulator_limit, accumulator_limit));
+        } while (!acc.compare_exchange_weak(current, next, std::memory_order_relaxed));
+    }
+
+    /// 取出整数部分（向零取整）并饱和，余量放回累加器
+    static auto drain(std::atomic<int32_t>& acc, int32_t limit, int32_t shift) -> int32_t {
+        const int32_t value = acc.exchange(0, std::memory_order_acq_rel);
+        const int32_t out = std::clamp(value / (1 << shift), -limit, limit);
+        const int32_t rest = value - out * (1 << shift);
+        if (rest) {
+            accumulate(acc, rest);
+        }
+        return out;
+    }
+};
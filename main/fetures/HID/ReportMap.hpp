@@ -0,0 +1,108 @@
+#pragma once
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 编译期 HID 报告描述符解析
+ *
+ * 只处理短条目与 Report ID/Size/Count、Logical Min/Max、Input、Collection，
+ * 足以在编译期核对报告描述符与打包后的报告结构体是否一致。
+ */
+namespace report_map {
+    struct Summary {
+        size_t input_bits = 0;  // 指定报告 ID 的 Input 总位数
+        bool well_formed = true;  // 条目没有越界且集合成对
+        bool ranges_fit = true;  // 每个 Input 的逻辑范围都能放进 Report Size
+    };
+
+    template<size_t N>
+    constexpr auto parse(const std::array<uint8_t, N>& desc, uint8_t report_id) -> Summary {
+        Summary out;
+        uint8_t id = 0;
+        uint32_t size = 0;
+        uint32_t count = 0;
+        int64_t logical_min = 0;
+        int64_t logical_max = 0;
+        int depth = 0;
+
+        for (size_t i = 0; i < N;) {
+            const uint8_t prefix = desc[i];
+            if (prefix == 0xFE) {
+                // 长条目：0xFE, 数据长度, 标签, 数据...
+                if (i + 1 >= N) {
+                    out.well_formed = false;
+                    break;
+                }
+                i += 3 + desc[i + 1];
+                continue;
+            }
+
+            const size_t len = (prefix & 0x03) == 3 ? 4 : (prefix & 0x03);
+            if (i + len >= N) {
+                out.well_formed = false;
+                break;
+            }
+            uint32_t data = 0;
+            for (size_t b = 0; b < len; ++b) {
+                data |= static_cast<uint32_t>(desc[i + 1 + b]) << (8 * b);
+            }
+            // 逻辑范围是有符号数，按条目长度做符号扩展
+            int64_t sdata = data;
+            if (len && (data >> (8 * len - 1)) & 1) {
+                sdata -= int64_t(1) << (8 * len);
+            }
+
+            switch (prefix & 0xFC) {
+                case 0x84: {
+                    id = data;
+                } break;
+                case 0x74: {
+                    size = data;
+                } break;
+                case 0x94: {
+                    count = data;
+                } break;
+                case 0x14: {
+                    logical_min = sdata;
+                } break;
+                case 0x24: {
+                    logical_max = sdata;
+                } break;
+                case 0xA0: {
+                    ++depth;
+                } break;
+                case 0xC0: {
+                    if (--depth < 0) {
+                        out.well_formed = false;
+                    }
+                } break;
+                case 0x80: {
+                    if (id == report_id) {
+                        out.input_bits += size * count;
+                    }
+                    // bit0 为 Constant 的填充位不检查范围
+                    if (!(data & 0x01) && size < 32) {
+                        const bool fit = logical_min < 0 ? (logical_min >= -(int64_t(1) << (size - 1)) && logical_max < (int64_t(1) << (size - 1)))
+                                                         : logical_max < (int64_t(1) << size);
+                        out.ranges_fit = out.ranges_fit && fit;
+                    }
+                } break;
+                default:
+                    break;
+            }
+            i += 1 + len;
+        }
+        if (depth != 0) {
+            out.well_formed = false;
+        }
+        return out;
+    }
+
+    /// 描述符中某报告 ID 的 Input 部分是否与结构体大小一致（报告 ID 本身不在结构体内）
+    template<typename Report, size_t N>
+    constexpr auto matches(const std::array<uint8_t, N>& desc, uint8_t report_id) -> bool {
+        const Summary s = parse(desc, report_id);
+        return s.well_formed && s.ranges_fit && s.input_bits == sizeof(Report) * 8;
+    }
+} // namespace report_map
@@ -0,0 +1,260 @@
+#include "Input.hpp"
+#include <algorithm>
+#include "../HID/Accel.hpp"
+#include "../HID/HID.hpp"
+#include "esp_timer.h"
+
+Input::Input() {
+    touch();
+}
+
+Input::~Input() {
+    touch();
+}
+
+void Input::registrator() {
+    const esp_timer_create_args_t args{
+            .callback = [](void* arg) { static_cast<Input*>(arg)->wake(); },
+            .arg = this,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "input",
+            .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &timer_));
+
+    BaseType_t ret = xTaskCreatePinnedToCore(task, "input", 4096, this, CONFIG_INPUT_TASK_PRIORITY, &task_, CONFIG_INPUT_TASK_CORE);
+    if (ret != pdPASS) {
+        ESP_LOGE("Input", "输入任务创建失败");
+    }
+}
+
+auto Input::submit(const Command& cmd) -> bool {
+    if (!queue_.push(cmd)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    BLEBase::note_activity();
+
+    const uint32_t depth = queue_.size();
+    uint32_t max_depth = max_depth_.load(std::memory_order_relaxed);
+    while (depth > max_depth && !max_depth_.compare_exchange_weak(max_depth, depth, std::memory_order_relaxed)) {
+    }
+
+    wake();
+    return true;
+}
+
+auto Input::wake() -> void {
+    if (task_) {
+        xTaskNotifyGive(task_);
+    }
+}
+
+auto Input::get_stats() const -> Stats {
+    const uint32_t timed = timed_.load(std::memory_order_relaxed);
+    return {
+            submitted_.load(std::memory_order_relaxed),
+            dropped_.load(std::memory_order_relaxed),
+            executed_.load(std::memory_order_relaxed),
+            static_cast<uint32_t>(queue_.size()),
+            max_depth_.load(std::memory_order_relaxed),
+            reports_.load(std::memory_order_relaxed),
+            reports_per_second_.load(std::memory_order_relaxed),
+            timed,
+            timed_dropped_.load(std::memory_order_relaxed),
+            late_.load(std::memory_order_relaxed),
+            max_late_us_.load(std::memory_order_relaxed),
+            timed ? static_cast<uint32_t>(total_late_us_.load(std::memory_order_relaxed) / timed) : 0,
+            HID::instance()->keys_sent(),
+            keys_dropped_.load(std::memory_order_relaxed),
+            keys_per_second_.load(std::memory_order_relaxed),
+    };
+}
+
+namespace {
+    // 最小堆比较：执行时刻越早越靠前
+    auto later(const Input::Command& a, const Input::Command& b) -> bool {
+        return a.at_us > b.at_us;
+    }
+} // namespace
+
+auto Input::schedule(const Command& cmd) -> bool {
+    if (timed_count_ >= timed_heap_.size()) {
+        timed_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    timed_heap_[timed_count_++] = cmd;
+    std::push_heap(timed_heap_.begin(), timed_heap_.begin() + timed_count_, later);
+    return true;
+}
+
+void Input::execute_timed(const Command& cmd, int64_t now) {
+    execute(cmd);
+    const auto late_us = static_cast<uint32_t>(std::max<int64_t>(now - cmd.at_us, 0));
+    timed_.fetch_add(1, std::memory_order_relaxed);
+    total_late_us_.fetch_add(late_us, std::memory_order_relaxed);
+    if (late_us > CONFIG_INPUT_LATE_THRESHOLD_US) {
+        late_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (late_us > max_late_us_.load(std::memory_order_relaxed)) {
+        max_late_us_.store(late_us, std::memory_order_relaxed);
+    }
+}
+
+void Input::arm(int64_t at) {
+    esp_timer_stop(timer_);
+    esp_timer_start_once(timer_, std::max<int64_t>(at - esp_timer_get_time(), 1));
+}
+
+void Input::task(void* arg) {
+    constexpr int64_t default_interval_us = 7500;
+
+    auto* self = static_cast<Input*>(arg);
+    auto hid = HID::instance();
+    Command cmd;
+    bool pending = false;
+    int64_t next_emit = 0;
+    int64_t window_start = esp_timer_get_time();
+    uint32_t window_reports = 0;
+    uint32_t window_keys = hid->keys_sent();
+
+    int64_t hold_until = 0;
+
+    while (true) {
+        int64_t wake_at = INT64_MAX;
+        if (pending) {
+            wake_at = next_emit;
+        }
+        if (self->queue_.size() != 0) {
+            wake_at = std::min(wake_at, hold_until);
+        }
+
+        if (self->timed_count_ != 0) {
+            wake_at = std::min(wake_at, self->timed_heap_.front().at_us);
+        }
+
+        // 截止时刻已到则不等待，否则交给 esp_timer 在截止时刻唤醒
+        if (wake_at == INT64_MAX) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        } else if (wake_at > esp_timer_get_time()) {
+            self->arm(wake_at);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        } else {
+            ulTaskNotifyTake(pdTRUE, 0);
+        }
+
+        int64_t now = esp_timer_get_time();
+        while (self->timed_count_ != 0 && self->timed_heap_.front().at_us <= now) {
+            std::pop_heap(self->timed_heap_.begin(), self->timed_heap_.begin() + self->timed_count_, later);
+            self->execute_timed(self->timed_heap_[--self->timed_count_], now);
+        }
+
+        while (now >= hold_until && self->queue_.pop(cmd)) {
+            if (cmd.at_us) {
+                if (cmd.at_us > now) {
+                    self->schedule(cmd);
+                } else {
+                    self->execute_timed(cmd, now);
+                }
+                continue;
+            }
+            self->execute(cmd);
+            if (cmd.delay_us) {
+                hold_until = now + cmd.delay_us;
+            }
+        }
+
+        now = esp_timer_get_time();
+        pending = hid->pending();
+        if (pending && now >= next_emit) {
+            const uint32_t interval = BLEBase::get_conn_interval_us();
+            next_emit = now + (interval ? interval : default_interval_us);
+            // 订阅的链路全部拥塞时不取帧，位移与按键留在混合器里合并，解除后一帧发出最新状态；
+            // 只要还有一条链路能发就照常取帧，拥塞的链路自行排队或丢弃
+            if (!hid->backlogged()) {
+                pending = hid->flush();
+                self->finish_probes(esp_timer_get_time());
+                BLEBase::note_activity();
+                self->reports_.fetch_add(1, std::memory_order_relaxed);
+                ++window_reports;
+            }
+        }
+
+        if (now - window_start >= 1000000) {
+            const uint32_t keys = hid->keys_sent();
+            self->reports_per_second_.store(window_reports * 1000000ull / (now - window_start), std::memory_order_relaxed);
+            self->keys_per_second_.store((keys - window_keys) * 1000000ull / (now - window_start), std::memory_order_relaxed);
+            window_start = now;
+            window_reports = 0;
+            window_keys = keys;
+        }
+    }
+}
+
+void Input::execute(const Command& cmd) {
+    executed_.fetch_add(1, std::memory_order_relaxed);
+    auto hid = HID::instance();
+    switch (cmd.type) {
+        case Command::CLICK: {
+            hid->click(cmd.button);
+        } break;
+        case Command::PRESS: {
+            hid->press(cmd.button);
+        } break;
+        case Command::RELEASE: {
+            hid->release(cmd.button);
+        } break;
+        case Command::MOVE: {
+            relative(Mixer::to_fine(cmd.x), Mixer::to_fine(cmd.y));
+        } break;
+        case Command::MOVE_FINE: {
+            relative(cmd.x, cmd.y);
+        } break;
+        case Command::WHEEL: {
+            hid->wheel(cmd.wheel);
+        } break;
+        case Command::KEY: {
+            if (!hid->key(cmd.x, cmd.button)) {
+                keys_dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        } break;
+        case Command::MOVE_TO: {
+            hid->move_to(cmd.x, cmd.y);
+        } break;
+        case Command::SAMPLE: {
+            relative(Mixer::to_fine(cmd.x), Mixer::to_fine(cmd.y));
+            if (cmd.wheel) {
+                hid->wheel(cmd.wheel);
+            }
+            if (cmd.button) {
+                hid->click(cmd.button);
+            }
+        } break;
+        case Command::PROBE: {
+            const int64_t now = esp_timer_get_time();
+            const auto handler = probe_handler_.load(std::memory_order_acquire);
+            if (!hid->pending() || probe_count_ == probes_.size()) {
+                // 没有待发报告就不会有下一帧，等待表满时不再等
+                if (handler) {
+                    handler(static_cast<uint32_t>(cmd.x), now, now);
+                }
+            } else {
+                probes_[probe_count_++] = {static_cast<uint32_t>(cmd.x), now};
+            }
+        } break;
+    }
+}
+
+void Input::finish_probes(int64_t emit_us) {
+    const auto handler = probe_handler_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < probe_count_ && handler; ++i) {
+        handler(probes_[i].id, probes_[i].dequeue_us, emit_us);
+    }
+    probe_count_ = 0;
+}
+
+void Input::relative(int32_t x, int32_t y) {
+    accel::apply(x, y);
+    HID::instance()->move_fine(x, y);
+}
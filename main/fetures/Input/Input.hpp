@@ -0,0 +1,132 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include "../../lockfree_queue.hpp"
+#include "../Features.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * @brief 输入引擎
+ *
+ * GATTS 写回调只把命令压入无锁队列后立即返回，由固定在 CONFIG_INPUT_TASK_CORE 上的
+ * 独立任务取出命令并生成 HID 报告，BTC 任务不再被 HID 发送节奏阻塞。
+ * 报告按当前连接间隔调度：每个连接事件最多发出一帧合并后的报告。
+ * 带 at_us 的命令按设备时钟定时执行，所有唤醒都由 esp_timer 单次定时器触发，不受 tick 粒度限制。
+ */
+class Input : public FeatureRegistrar<Input> {
+public:
+    Input();
+    ~Input();
+
+    struct Command {
+        // MOVE_FINE 的 x/y 为 Q8 定点(1/256 像素)；KEY 的 x 为用法码，button 为修饰键；PROBE 的 x 为探针 id
+        enum Type : uint8_t { CLICK, MOVE, WHEEL, SAMPLE, MOVE_TO, MOVE_FINE, KEY, PRESS, RELEASE, PROBE };
+        Type type;
+        uint8_t button;
+        int8_t wheel;
+        // 执行本命令后暂停取后续命令的时长(µs)
+        uint16_t delay_us;
+        int32_t x;
+        int32_t y;
+        // 执行时刻(esp_timer_get_time 时钟，µs)，0 表示立即执行
+        int64_t at_us;
+    };
+
+    struct Stats {
+        uint32_t submitted;
+        uint32_t dropped;
+        uint32_t executed;
+        uint32_t depth;
+        uint32_t max_depth;
+        uint32_t reports;
+        uint32_t reports_per_second;
+        uint32_t timed;
+        uint32_t timed_dropped;
+        uint32_t late;
+        uint32_t max_late_us;
+        uint32_t avg_late_us;
+        uint32_t keys;
+        uint32_t keys_dropped;
+        uint32_t keys_per_second;
+    };
+
+    /**
+     * @brief 投递一条输入命令，不阻塞
+     * @return 队列已满时返回 false，命令被丢弃
+     */
+    auto submit(const Command& cmd) -> bool;
+
+    /// 队列剩余空间，近似值，用于一次写入拆成多条命令前的检查
+    auto available() const -> size_t {
+        return queue_.capacity() - std::min(queue_.size(), queue_.capacity());
+    }
+
+    /// 唤醒输入任务，直接向 HID 混合器提交数据的生产者调用
+    auto wake() -> void;
+
+    auto get_stats() const -> Stats;
+
+    /**
+     * @brief 延迟探针完成回调，在输入任务中调用
+     * @param dequeue_us 输入任务取出探针的时刻
+     * @param emit_us 探针之后第一帧 HID 报告交给协议栈的时刻，取出时没有待发报告则与 dequeue_us 相同
+     */
+    using ProbeHandler = void (*)(uint32_t id, int64_t dequeue_us, int64_t emit_us);
+
+    /// 静态保存，注册方可能先于 Input 创建
+    static auto on_probe(ProbeHandler _handler) -> void {
+        probe_handler_.store(_handler, std::memory_order_release);
+    }
+
+    auto registrator() -> void override;
+
+private:
+    LockFreeQueue<Command, CONFIG_INPUT_QUEUE_LENGTH> queue_;
+    TaskHandle_t task_ = nullptr;
+
+    std::atomic<uint32_t> submitted_{0};
+    std::atomic<uint32_t> dropped_{0};
+    std::atomic<uint32_t> executed_{0};
+    std::atomic<uint32_t> max_depth_{0};
+    std::atomic<uint32_t> reports_{0};
+    std::atomic<uint32_t> reports_per_second_{0};
+    std::atomic<uint32_t> timed_{0};
+    std::atomic<uint32_t> timed_dropped_{0};
+    std::atomic<uint32_t> late_{0};
+    std::atomic<uint32_t> max_late_us_{0};
+    std::atomic<uint64_t> total_late_us_{0};
+    std::atomic<uint32_t> keys_dropped_{0};
+    std::atomic<uint32_t> keys_per_second_{0};
+
+    // 定时命令最小堆，仅输入任务访问
+    std::array<Command, CONFIG_INPUT_SCHEDULE_LENGTH> timed_heap_;
+    size_t timed_count_ = 0;
+    esp_timer_handle_t timer_ = nullptr;
+
+    // 已取出、等待下一帧报告的探针，仅输入任务访问
+    struct PendingProbe {
+        uint32_t id;
+        int64_t dequeue_us;
+    };
+    std::array<PendingProbe, 8> probes_;
+    size_t probe_count_ = 0;
+    inline static std::atomic<ProbeHandler> probe_handler_{nullptr};
+
+    static void task(void* arg);
+    /// 下一帧报告已发出，完成全部等待中的探针
+    void finish_probes(int64_t emit_us);
+    void execute(const Command& cmd);
+    /// 经加速曲线后提交 Q8 相对位移
+    void relative(int32_t x, int32_t y);
+
+    /// 放入定时堆，堆满返回 false
+    auto schedule(const Command& cmd) -> bool;
+    /// 执行定时命令并记录迟到时长
+    void execute_timed(const Command& cmd, int64_t now);
+    /// 在 at 时刻唤醒输入任务
+    void arm(int64_t at);
+};
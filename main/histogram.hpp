@@ -0,0 +1,63 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 固定内存的对数分桶直方图
+ *
+ * 第 0 桶只放 0，第 i 桶放 [2^(i-1), 2^i) 的值，最后一桶收容全部更大的值。
+ * add 无锁，任意线程可调用；分位数取所在桶的上界，误差不超过一倍。
+ * @tparam N 桶数
+ */
+template<size_t N>
+class Histogram {
+    static_assert(N >= 2 && N <= 33, "bucket count out of range");
+
+public:
+    static constexpr size_t bucket_count = N;
+
+    void add(uint32_t _value) {
+        buckets_[std::min<size_t>(std::bit_width(_value), N - 1)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto snapshot() const -> std::array<uint32_t, N> {
+        std::array<uint32_t, N> out;
+        for (size_t i = 0; i < N; ++i) {
+            out[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        return out;
+    }
+
+    /// 分位数 _q∈[0,1] 所在桶的上界，没有样本时为 0
+    [[nodiscard]] auto percentile(double _q) const -> uint32_t {
+        const auto counts = snapshot();
+        uint64_t total = 0;
+        for (const uint32_t c : counts) {
+            total += c;
+        }
+        if (total == 0) {
+            return 0;
+        }
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(_q * total + 0.999999));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < N; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return upper(i);
+            }
+        }
+        return upper(N - 1);
+    }
+
+    /// 第 i 桶能放下的最大值
+    static constexpr auto upper(size_t i) -> uint32_t {
+        return i == 0 ? 0 : i >= 32 ? UINT32_MAX : static_cast<uint32_t>((uint64_t(1) << i) - 1);
+    }
+
+private:
+    std::array<std::atomic<uint32_t>, N> buckets_{};
+};
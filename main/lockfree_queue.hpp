@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+/**
+ * @brief 有界无锁队列（多生产者/多消费者）
+ *
+ * 每个槽位带一个序号，生产者和消费者各自只 CAS 自己的游标，不会互相阻塞。
+ * 队列满时 push 直接返回 false，由调用方决定丢弃还是重试。
+ * @tparam T 元素类型，需可平凡拷贝
+ * @tparam N 容量，必须是 2 的幂
+ */
+template<typename T, size_t N>
+class LockFreeQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "element must be trivially copyable");
+
+public:
+    LockFreeQueue() {
+        for (size_t i = 0; i < N; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    auto operator=(const LockFreeQueue&) -> LockFreeQueue& = delete;
+
+    auto push(const T& _value) -> bool {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & (N - 1)];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = _value;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    auto pop(T& _value) -> bool {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & (N - 1)];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+        _value = cell->value;
+        cell->seq.store(pos + N, std::memory_order_release);
+        return true;
+    }
+
+    /// 近似长度，仅用于统计
+    [[nodiscard]] auto size() const -> size_t {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    [[nodiscard]] static constexpr auto capacity() -> size_t {
+        return N;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    Cell cells_[N];
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+};
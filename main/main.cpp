@@ -16,6 +16,7 @@
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "fetures/BLE.hpp"
+#include "fetures/Bench/DispatchBench.hpp"
 #include "fetures/Battery/Battery.hpp"
 #include "fetures/Features.hpp"
 #include "fetures/HID/HID.hpp"
@@ -148,6 +149,15 @@ extern "C" void app_main(void) {
 
     Event::instance()->touch();
 
+#if CONFIG_BLE_DISPATCH_BENCH
+    std::thread([] {
+        while (!DispatchBench::ready()) {
+            std::this_thread::sleep_for(100ms);
+        }
+        ESP_LOGI("DispatchBench", "%s", DispatchBench::run(CONFIG_BLE_DISPATCH_BENCH_ITERATIONS).c_str());
+    }).detach();
+#endif
+
     bool condition = false;
     std::thread([&condition] {
         while (true) {
@@ -166,6 +176,7 @@ extern "C" void app_main(void) {
         }
 
         Battery::instance()->notify();
+        BLEBase::save_subscriptions();
 
         size_t free_heap = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
         size_t total_heap = heap_caps_get_total_size(MALLOC_CAP_DEFAULT);
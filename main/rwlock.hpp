@@ -1,5 +1,9 @@
 #pragma once
 #include <pthread.h>
+#include "sdkconfig.h"
+#if CONFIG_BLE_DISPATCH_BENCH
+#include <atomic>
+#endif
 
 class RWLock {
 public:
@@ -11,9 +15,15 @@ public:
     }
 
     void rd_lock() {
+#if CONFIG_BLE_DISPATCH_BENCH
+        acquisitions.fetch_add(1, std::memory_order_relaxed);
+#endif
         pthread_rwlock_rdlock(&rw_);
     }
     void wr_lock() {
+#if CONFIG_BLE_DISPATCH_BENCH
+        acquisitions.fetch_add(1, std::memory_order_relaxed);
+#endif
         pthread_rwlock_wrlock(&rw_);
     }
     void unlock() {
@@ -44,6 +54,11 @@ public:
         RWLock& lock_;
     };
 
+#if CONFIG_BLE_DISPATCH_BENCH
+    /// 加锁次数统计，仅供分发基准测试使用
+    inline static std::atomic<uint32_t> acquisitions{0};
+#endif
+
 private:
     pthread_rwlock_t rw_;
 };
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <thread>
+#include "sdkconfig.h"
+
+/**
+ * @brief 顺序锁
+ *
+ * 序号为奇数表示正在写入。读者不加锁：拷贝完数据后再比对一次序号，不一致就重读；
+ * 写者之间用 CAS 互斥，保证报告不会被两个写者交错写坏。
+ * 读写双方自旋一段时间仍拿不到一致状态时都会主动让出，避免高优先级任务把同核上被抢占的写者饿死。
+ */
+class SeqLock {
+public:
+    void wr_lock() {
+#if CONFIG_BLE_DISPATCH_BENCH
+        acquisitions.fetch_add(1, std::memory_order_relaxed);
+#endif
+        uint32_t spins = 0;
+        uint32_t seq = seq_.load(std::memory_order_relaxed);
+        while ((seq & 1) || !seq_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            // 持有者可能是同核上优先级更低的任务，自旋一段时间后主动让出
+            if (++spins > max_spins) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                spins = 0;
+            }
+            seq = seq_.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void unlock() {
+        seq_.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief 无锁读取
+     * @param _copy 拷贝数据的函数，可能因写者并发而被调用多次
+     * @return 重读次数
+     */
+    template<typename F>
+    auto read(F&& _copy) const -> uint32_t {
+        uint32_t retries = 0;
+        uint32_t spins = 0;
+        while (true) {
+            const uint32_t begin = seq_.load(std::memory_order_acquire);
+            if (!(begin & 1)) {
+                _copy();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq_.load(std::memory_order_relaxed) == begin) {
+                    return retries;
+                }
+            }
+            ++retries;
+            // 写者被同核上的读者抢占时，只有让出 CPU 它才能写完
+            if (++spins > max_spins) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                spins = 0;
+            }
+        }
+    }
+
+    struct WriteGuard {
+        explicit WriteGuard(SeqLock& l) : lock_(l) {
+            lock_.wr_lock();
+        }
+        ~WriteGuard() {
+            lock_.unlock();
+        }
+
+    private:
+        SeqLock& lock_;
+    };
+
+#if CONFIG_BLE_DISPATCH_BENCH
+    /// 写者加锁次数统计，仅供分发基准测试使用
+    inline static std::atomic<uint32_t> acquisitions{0};
+#endif
+
+private:
+    static constexpr uint32_t max_spins = 64;
+
+    std::atomic<uint32_t> seq_{0};
+};